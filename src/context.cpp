@@ -0,0 +1,318 @@
+#include "context.h"
+#include "glext.h"
+
+#include <chrono>
+#include <iostream>
+
+#ifdef OGL_HAS_GLFW
+#include <GLFW/glfw3.h>
+#endif
+
+#ifdef OGL_HAS_EGL
+// keep X11 out of the build, we only need surfaceless/device displays
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#ifdef OGL_HAS_OSMESA
+#include <GL/osmesa.h>
+#include <vector>
+#endif
+
+double Context::getTime() const
+{
+	static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ----------------------------------------------------------------------------
+// GLFW window
+// ----------------------------------------------------------------------------
+#ifdef OGL_HAS_GLFW
+class GLFWContext : public Context
+{
+public:
+	GLFWContext(unsigned int width, unsigned int height) : Context(width, height), handle(NULL) {}
+	~GLFWContext()
+	{
+		if (handle)
+			glfwDestroyWindow(handle);
+		glfwTerminate();
+	}
+
+	bool create(const char* title, int major, int minor)
+	{
+		// Initialse GLFW
+		if (!glfwInit()) {
+			std::cout << "Failed to initialise GLFW" << std::endl;
+			return false;
+		}
+		// Setup GLFW hints
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		// Create and verify window
+		handle = glfwCreateWindow(width, height, title, NULL, NULL);
+		if (handle == NULL) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool makeCurrent() override { glfwMakeContextCurrent(handle); return true; }
+	GLADloadproc loader() const override { return (GLADloadproc)glfwGetProcAddress; }
+	bool hasDefaultFramebuffer() const override { return true; }
+	bool shouldClose() const override { return glfwWindowShouldClose(handle); }
+	void swapBuffers() override { glfwSwapBuffers(handle); }
+	void pollEvents() override { glfwPollEvents(); }
+	double getTime() const override { return glfwGetTime(); }
+	GLFWwindow* window() const override { return handle; }
+	const char* name() const override { return "glfw"; }
+
+private:
+	GLFWwindow* handle;
+};
+#endif
+
+// ----------------------------------------------------------------------------
+// Surfaceless EGL
+// ----------------------------------------------------------------------------
+#ifdef OGL_HAS_EGL
+class EGLSurfacelessContext : public Context
+{
+public:
+	EGLSurfacelessContext(unsigned int width, unsigned int height) :
+		Context(width, height), display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+	~EGLSurfacelessContext()
+	{
+		if (display != EGL_NO_DISPLAY) {
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (context != EGL_NO_CONTEXT)
+				eglDestroyContext(display, context);
+			eglTerminate(display);
+		}
+	}
+
+	bool create(int major, int minor)
+	{
+		display = openDisplay();
+		EGLint eglMajor, eglMinor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor)) {
+			std::cout << "Failed to initialise EGL display: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+			display = EGL_NO_DISPLAY;
+			return false;
+		}
+		std::string extensions = eglQueryString(display, EGL_EXTENSIONS);
+		if (extensions.find("EGL_KHR_surfaceless_context") == std::string::npos) {
+			std::cout << "EGL display does not support EGL_KHR_surfaceless_context" << std::endl;
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			std::cout << "EGL does not support desktop OpenGL" << std::endl;
+			return false;
+		}
+		// no surface is ever created so a config is only needed if the
+		// display lacks EGL_KHR_no_config_context
+		EGLConfig config = EGL_NO_CONFIG_KHR;
+		if (extensions.find("EGL_KHR_no_config_context") == std::string::npos) {
+			const EGLint configAttribs[] = {
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_NONE
+			};
+			EGLint count = 0;
+			if (!eglChooseConfig(display, configAttribs, &config, 1, &count) || count == 0) {
+				std::cout << "Failed to choose EGL config" << std::endl;
+				return false;
+			}
+		}
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, major,
+			EGL_CONTEXT_MINOR_VERSION, minor,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+		if (context == EGL_NO_CONTEXT) {
+			std::cout << "Failed to create EGL context: 0x" << std::hex << eglGetError() << std::dec << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool makeCurrent() override { return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context); }
+	GLADloadproc loader() const override { return (GLADloadproc)eglGetProcAddress; }
+	const char* name() const override { return "egl"; }
+
+private:
+	EGLDisplay display;
+	EGLContext context;
+
+	// Prefer the Mesa surfaceless platform, then the first EGL device, then
+	// whatever the default display is.
+	static EGLDisplay openDisplay()
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+		std::string client = clientExtensions ? clientExtensions : "";
+		if (getPlatformDisplay) {
+			if (client.find("EGL_MESA_platform_surfaceless") != std::string::npos) {
+				EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+				if (d != EGL_NO_DISPLAY)
+					return d;
+			}
+			PFNEGLQUERYDEVICESEXTPROC queryDevices =
+				(PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+			if (queryDevices && client.find("EGL_EXT_platform_device") != std::string::npos) {
+				EGLDeviceEXT device;
+				EGLint count = 0;
+				if (queryDevices(1, &device, &count) && count > 0) {
+					EGLDisplay d = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+					if (d != EGL_NO_DISPLAY)
+						return d;
+				}
+			}
+		}
+		return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+};
+#endif
+
+// ----------------------------------------------------------------------------
+// OSMesa
+// ----------------------------------------------------------------------------
+#ifdef OGL_HAS_OSMESA
+class OSMesaOffscreenContext : public Context
+{
+public:
+	OSMesaOffscreenContext(unsigned int width, unsigned int height) : Context(width, height), context(NULL) {}
+	~OSMesaOffscreenContext()
+	{
+		if (context)
+			OSMesaDestroyContext(context);
+	}
+
+	bool create(int major, int minor)
+	{
+		const int attribs[] = {
+			OSMESA_FORMAT, OSMESA_RGBA,
+			OSMESA_DEPTH_BITS, 24,
+			OSMESA_STENCIL_BITS, 8,
+			OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+			OSMESA_CONTEXT_MAJOR_VERSION, major,
+			OSMESA_CONTEXT_MINOR_VERSION, minor,
+			0
+		};
+		context = OSMesaCreateContextAttribs(attribs, NULL);
+		if (!context) {
+			std::cout << "Failed to create OSMesa context" << std::endl;
+			return false;
+		}
+		// OSMesa always needs a colour buffer to make the context current
+		buffer.resize((size_t)width * height * 4);
+		return true;
+	}
+
+	bool makeCurrent() override { return OSMesaMakeCurrent(context, buffer.data(), GL_UNSIGNED_BYTE, width, height); }
+	GLADloadproc loader() const override { return (GLADloadproc)OSMesaGetProcAddress; }
+	// the OSMesa buffer acts as framebuffer 0
+	bool hasDefaultFramebuffer() const override { return true; }
+	const char* name() const override { return "osmesa"; }
+
+private:
+	OSMesaContext context;
+	std::vector<unsigned char> buffer;
+};
+#endif
+
+bool contextBackendAvailable(ContextBackend backend)
+{
+	switch (backend) {
+#ifdef OGL_HAS_GLFW
+	case CONTEXT_GLFW: return true;
+#endif
+#ifdef OGL_HAS_EGL
+	case CONTEXT_EGL: return true;
+#endif
+#ifdef OGL_HAS_OSMESA
+	case CONTEXT_OSMESA: return true;
+#endif
+	default: return false;
+	}
+}
+
+bool parseContextBackend(const std::string& name, ContextBackend& backend)
+{
+	if (name == "glfw")
+		backend = CONTEXT_GLFW;
+	else if (name == "egl")
+		backend = CONTEXT_EGL;
+	else if (name == "osmesa")
+		backend = CONTEXT_OSMESA;
+	else
+		return false;
+	return true;
+}
+
+std::unique_ptr<Context> createContext(ContextBackend backend, unsigned int width, unsigned int height,
+	const char* title, int major, int minor)
+{
+#ifndef OGL_HAS_GLFW
+	// only windows have a title
+	(void)title;
+#endif
+	switch (backend) {
+#ifdef OGL_HAS_GLFW
+	case CONTEXT_GLFW: {
+		std::unique_ptr<GLFWContext> context(new GLFWContext(width, height));
+		if (context->create(title, major, minor))
+			return context;
+		return nullptr;
+	}
+#endif
+#ifdef OGL_HAS_EGL
+	case CONTEXT_EGL: {
+		std::unique_ptr<EGLSurfacelessContext> context(new EGLSurfacelessContext(width, height));
+		if (context->create(major, minor))
+			return context;
+		return nullptr;
+	}
+#endif
+#ifdef OGL_HAS_OSMESA
+	case CONTEXT_OSMESA: {
+		std::unique_ptr<OSMesaOffscreenContext> context(new OSMesaOffscreenContext(width, height));
+		if (context->create(major, minor))
+			return context;
+		return nullptr;
+	}
+#endif
+	default:
+		std::cout << "ERROR::CONTEXT::Backend not compiled into this build" << std::endl;
+		return nullptr;
+	}
+}
+
+std::unique_ptr<Context> createContextAndLoadGL(ContextBackend backend, unsigned int width, unsigned int height,
+	const char* title, int major, int minor)
+{
+	std::unique_ptr<Context> context = createContext(backend, width, height, title, major, minor);
+	if (!context)
+		return nullptr;
+	// Set context to current
+	if (!context->makeCurrent()) {
+		std::cout << "Failed to make " << context->name() << " context current" << std::endl;
+		return nullptr;
+	}
+	// Intitialise and verify GLAD
+	if (!gladLoadGLLoader(context->loader())) {
+		std::cout << "Failed to initialise GLAD" << std::endl;
+		return nullptr;
+	}
+	// Entry points beyond GL 3.3
+	loadGLExtensions(context->loader());
+	return context;
+}
@@ -0,0 +1,55 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <memory>
+#include <string>
+
+// Backends that can provide an OpenGL context. GLFW opens a window, the
+// others are offscreen and render into a user provided framebuffer object.
+enum ContextBackend {
+	CONTEXT_GLFW,
+	CONTEXT_EGL,		// surfaceless EGL (EGL_MESA_platform_surfaceless or device)
+	CONTEXT_OSMESA		// OSMesa software rasteriser (llvmpipe)
+};
+
+struct GLFWwindow;
+
+class Context
+{
+public:
+	unsigned int width, height;
+
+	Context(unsigned int width, unsigned int height) : width(width), height(height) {}
+	virtual ~Context() {}
+
+	// Make the context current on the calling thread
+	virtual bool makeCurrent() = 0;
+	// Procedure loader to hand to gladLoadGLLoader
+	virtual GLADloadproc loader() const = 0;
+	// Offscreen contexts have no default framebuffer, the caller has to
+	// render into its own FBO.
+	virtual bool hasDefaultFramebuffer() const { return false; }
+	virtual bool shouldClose() const { return false; }
+	virtual void swapBuffers() {}
+	virtual void pollEvents() {}
+	virtual double getTime() const;
+	// Native window for backends that have one
+	virtual GLFWwindow* window() const { return nullptr; }
+	virtual const char* name() const = 0;
+};
+
+// Returns whether the backend was compiled in
+bool contextBackendAvailable(ContextBackend backend);
+// Parses "glfw", "egl" or "osmesa", returns false on unknown names
+bool parseContextBackend(const std::string& name, ContextBackend& backend);
+// Creates a core profile context of at least the requested version. Returns
+// nullptr (and prints the reason) when the backend is unavailable or fails.
+std::unique_ptr<Context> createContext(ContextBackend backend, unsigned int width, unsigned int height,
+	const char* title = "LearnOpenGL", int major = 3, int minor = 3);
+// Creates the context and loads the GL function pointers through GLAD
+std::unique_ptr<Context> createContextAndLoadGL(ContextBackend backend, unsigned int width, unsigned int height,
+	const char* title = "LearnOpenGL", int major = 3, int minor = 3);
+
+#endif // !CONTEXT_H
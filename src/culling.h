@@ -0,0 +1,162 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OGL_CULLING_SSE
+#endif
+
+#include "mesh.h"
+
+// The six planes of a view volume, normals pointing inwards and normalized
+// so a plane equation gives a distance in world units
+struct Frustum
+{
+	glm::vec4 planes[6];	// left, right, bottom, top, near, far
+
+	// Planes of projection * view (Gribb and Hartmann), the rows of the
+	// matrix added to or subtracted from its last row
+	static Frustum fromMatrix(const glm::mat4& viewProjection)
+	{
+		glm::mat4 m = glm::transpose(viewProjection);
+		Frustum frustum;
+		frustum.planes[0] = m[3] + m[0];
+		frustum.planes[1] = m[3] - m[0];
+		frustum.planes[2] = m[3] + m[1];
+		frustum.planes[3] = m[3] - m[1];
+		frustum.planes[4] = m[3] + m[2];
+		frustum.planes[5] = m[3] - m[2];
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+		return frustum;
+	}
+};
+
+// World space bounds of the objects drawn in a frame and whether they are
+// in view. Each object keeps a sphere and a box around the same centre,
+// stored as separate arrays so cull() tests four objects per plane at once.
+// Against a plane the smaller of the two extents is used, the sphere is
+// tighter for objects seen along a diagonal, the box for flat ones.
+class FrustumCuller
+{
+public:
+	FrustumCuller() : visibleCount(0), culledCount(0) {}
+
+	// Returns the index used with visible()
+	unsigned int add(const MeshBounds& bounds, const glm::mat4& model)
+	{
+		glm::vec3 center = glm::vec3(model * glm::vec4(bounds.center(), 1.0f));
+		glm::mat3 axes = glm::mat3(model);
+		// box extents along the world axes (Arvo), sphere scaled by the
+		// longest axis
+		glm::vec3 halfSize = (bounds.max - bounds.min) * 0.5f;
+		glm::vec3 extent = glm::vec3(0.0f);
+		for (int i = 0; i < 3; i++)
+			extent += glm::abs(axes[i]) * halfSize[i];
+		float scale = std::sqrt(std::max(glm::dot(axes[0], axes[0]), std::max(glm::dot(axes[1], axes[1]), glm::dot(axes[2], axes[2]))));
+
+		centerX.push_back(center.x);
+		centerY.push_back(center.y);
+		centerZ.push_back(center.z);
+		radius.push_back(bounds.radius * scale);
+		extentX.push_back(extent.x);
+		extentY.push_back(extent.y);
+		extentZ.push_back(extent.z);
+		visibility.push_back(1);
+		return visibility.size() - 1;
+	}
+	void clear()
+	{
+		centerX.clear();
+		centerY.clear();
+		centerZ.clear();
+		radius.clear();
+		extentX.clear();
+		extentY.clear();
+		extentZ.clear();
+		visibility.clear();
+	}
+	unsigned int size() const { return visibility.size(); }
+
+	// Test everything added against frustum, read the result with visible()
+	void cull(const Frustum& frustum)
+	{
+		unsigned int i = 0;
+#ifdef OGL_CULLING_SSE
+		for (; i + 4 <= visibility.size(); i += 4)
+			cull4(frustum, i);
+#endif
+		for (; i < visibility.size(); i++) {
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++) {
+				const glm::vec4& plane = frustum.planes[p];
+				float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+				float boxRadius = std::fabs(plane.x) * extentX[i] + std::fabs(plane.y) * extentY[i] + std::fabs(plane.z) * extentZ[i];
+				inside = distance >= -std::min(radius[i], boxRadius);
+			}
+			visibility[i] = inside;
+		}
+		for (i = 0; i < visibility.size(); i++) {
+			if (visibility[i])
+				visibleCount++;
+			else
+				culledCount++;
+		}
+	}
+
+	bool visible(unsigned int i) const { return visibility[i] != 0; }
+	glm::vec3 center(unsigned int i) const { return glm::vec3(centerX[i], centerY[i], centerZ[i]); }
+
+	// Objects passed and rejected by cull() since the last reset
+	unsigned int visibleObjects() const { return visibleCount; }
+	unsigned int culledObjects() const { return culledCount; }
+	void resetCounters()
+	{
+		visibleCount = 0;
+		culledCount = 0;
+	}
+
+private:
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> radius;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<unsigned char> visibility;
+	unsigned int visibleCount, culledCount;
+
+#ifdef OGL_CULLING_SSE
+	// Objects first to first + 3 against all planes
+	void cull4(const Frustum& frustum, unsigned int first)
+	{
+		__m128 cx = _mm_loadu_ps(&centerX[first]);
+		__m128 cy = _mm_loadu_ps(&centerY[first]);
+		__m128 cz = _mm_loadu_ps(&centerZ[first]);
+		__m128 r = _mm_loadu_ps(&radius[first]);
+		__m128 ex = _mm_loadu_ps(&extentX[first]);
+		__m128 ey = _mm_loadu_ps(&extentY[first]);
+		__m128 ez = _mm_loadu_ps(&extentZ[first]);
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_mul_ps(cy, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			__m128 boxRadius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane.y)))),
+				_mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane.z))));
+			__m128 limit = _mm_sub_ps(_mm_setzero_ps(), _mm_min_ps(r, boxRadius));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, limit));
+		}
+		int mask = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++)
+			visibility[first + k] = (mask >> k & 1) == 0;
+	}
+#endif
+};
+
+#endif // !CULLING_H
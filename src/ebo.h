@@ -7,6 +7,8 @@ public:
 	unsigned int id;
 	EBO(unsigned int indices[], GLsizeiptr size) {
 		glGenBuffers(1, &id);
+		// the element buffer binding belongs to the bound VAO
+		GLState::bindVertexArray(0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 	}
@@ -0,0 +1,58 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <glm/glm.hpp>
+
+#include "ubo.h"
+
+// Uniform block binding points shared by all programs
+const unsigned int FRAME_CONSTANTS_BINDING = 0;
+
+// Mirrors the std140 FrameConstants block in shaders/frame.glsl
+struct FrameConstants
+{
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec3 viewPos;
+	float padding;
+};
+static_assert(sizeof(FrameConstants) == 144, "FrameConstants must match the std140 layout");
+
+// Per-view camera constants. Every view owns a slot in one uniform buffer,
+// written once per frame and selected with glBindBufferRange, so programs
+// never need their camera uniforms set individually.
+class FrameUniforms
+{
+public:
+	FrameUniforms(unsigned int views) :
+		stride(alignedStride()), buffer(views * alignedStride()) {}
+
+	// Upload the constants of one view
+	void setView(unsigned int slot, const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos)
+	{
+		FrameConstants constants;
+		constants.projection = projection;
+		constants.view = view;
+		constants.viewPos = viewPos;
+		constants.padding = 0.0f;
+		buffer.update(slot * stride, sizeof(FrameConstants), &constants);
+	}
+	// Make the view current for all programs that use the block
+	void use(unsigned int slot) const
+	{
+		buffer.bindRange(FRAME_CONSTANTS_BINDING, slot * stride, sizeof(FrameConstants));
+	}
+	void Delete() { buffer.Delete(); }
+
+private:
+	GLsizeiptr stride;
+	UBO buffer;
+
+	static GLsizeiptr alignedStride()
+	{
+		GLsizeiptr alignment = UBO::offsetAlignment();
+		return (sizeof(FrameConstants) + alignment - 1) / alignment * alignment;
+	}
+};
+
+#endif // !FRAME_H
@@ -0,0 +1,281 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <glad/glad.h>
+
+#include "glext.h"
+
+// Kinds of state calls GLState filters
+enum GLStateCall {
+	GL_STATE_PROGRAM,
+	GL_STATE_VERTEX_ARRAY,
+	GL_STATE_ACTIVE_TEXTURE,
+	GL_STATE_TEXTURE,
+	GL_STATE_STENCIL_MASK,
+	GL_STATE_CAPABILITY,
+	GL_STATE_DEPTH_MASK,
+	GL_STATE_BLEND_FUNC,
+	GL_STATE_CALL_COUNT
+};
+
+struct GLStateCounters
+{
+	unsigned long long issued[GL_STATE_CALL_COUNT];
+	unsigned long long elided[GL_STATE_CALL_COUNT];
+
+	unsigned long long totalIssued() const { return sum(issued); }
+	unsigned long long totalElided() const { return sum(elided); }
+
+private:
+	static unsigned long long sum(const unsigned long long* calls)
+	{
+		unsigned long long n = 0;
+		for (unsigned int i = 0; i < GL_STATE_CALL_COUNT; i++)
+			n += calls[i];
+		return n;
+	}
+};
+
+// Depth test, depth writes and blending, as saved by a pass that changes
+// them and put back afterwards
+struct GLDepthBlendState
+{
+	bool depthTest;
+	bool depthMask;
+	bool blend;
+	GLenum blendSrc, blendDst;
+};
+
+// Shadow copy of the binding state of the single GL context. Calls that
+// would not change anything are dropped and counted. All program, vertex
+// array and texture binds, and the depth and blend state, have to go
+// through here or the shadow goes stale; after code that touches GL
+// directly call invalidate().
+class GLState
+{
+public:
+	static const unsigned int MAX_TEXTURE_UNITS = 32;
+
+	static void useProgram(GLuint program)
+	{
+		if (track(GL_STATE_PROGRAM, state.program == program))
+			return;
+		state.program = program;
+		glUseProgram(program);
+	}
+
+	// Vertex arrays also hold the element buffer binding, so buffers are
+	// only bound to GL_ELEMENT_ARRAY_BUFFER with the right VAO current.
+	static void bindVertexArray(GLuint vao)
+	{
+		if (track(GL_STATE_VERTEX_ARRAY, state.vertexArray == vao))
+			return;
+		state.vertexArray = vao;
+		glBindVertexArray(vao);
+	}
+
+	static void activeTexture(unsigned int unit)
+	{
+		if (track(GL_STATE_ACTIVE_TEXTURE, state.activeUnit == unit))
+			return;
+		state.activeUnit = unit;
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+
+	// Bind to the given unit, only switching the active unit when the
+	// texture is not already there
+	static void bindTexture(GLenum target, unsigned int unit, GLuint texture)
+	{
+		GLuint* slot = textureSlot(target, unit);
+		if (track(GL_STATE_TEXTURE, slot && *slot == texture))
+			return;
+		activeTexture(unit);
+		if (slot)
+			*slot = texture;
+		glBindTexture(target, texture);
+	}
+	// Bind to whatever unit is active, for creating and filling textures
+	static void bindTexture(GLenum target, GLuint texture)
+	{
+		bindTexture(target, state.activeUnit == UNKNOWN ? 0 : state.activeUnit, texture);
+	}
+
+	static void stencilMask(GLuint mask)
+	{
+		if (track(GL_STATE_STENCIL_MASK, state.stencilMaskValid && state.stencilMask == mask))
+			return;
+		state.stencilMask = mask;
+		state.stencilMaskValid = true;
+		glStencilMask(mask);
+	}
+
+	// GL_DEPTH_TEST and GL_BLEND are tracked, other capabilities are
+	// passed through
+	static void enable(GLenum capability, bool enabled)
+	{
+		GLuint* slot = capabilitySlot(capability);
+		if (track(GL_STATE_CAPABILITY, slot && *slot == (GLuint)enabled))
+			return;
+		if (slot)
+			*slot = enabled;
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+	}
+
+	static void depthMask(bool write)
+	{
+		if (track(GL_STATE_DEPTH_MASK, state.depthMask == (GLuint)write))
+			return;
+		state.depthMask = write;
+		glDepthMask(write ? GL_TRUE : GL_FALSE);
+	}
+
+	// Same factors for every draw buffer
+	static void blendFunc(GLenum src, GLenum dst)
+	{
+		if (track(GL_STATE_BLEND_FUNC, state.blendSrc == src && state.blendDst == dst))
+			return;
+		state.blendSrc = src;
+		state.blendDst = dst;
+		glBlendFunc(src, dst);
+	}
+	// Factors of one draw buffer (GL 4.0 or ARB_draw_buffers_blend). The
+	// buffers differ afterwards, so the next blendFunc() is always issued.
+	static void blendFunci(GLuint buffer, GLenum src, GLenum dst)
+	{
+		track(GL_STATE_BLEND_FUNC, false);
+		state.blendSrc = state.blendDst = UNKNOWN;
+		glBlendFunci(buffer, src, dst);
+	}
+
+	// Current depth and blend state, what the shadow does not know yet is
+	// queried once
+	static GLDepthBlendState depthBlendState()
+	{
+		if (state.depthTest == UNKNOWN)
+			state.depthTest = glIsEnabled(GL_DEPTH_TEST);
+		if (state.blend == UNKNOWN)
+			state.blend = glIsEnabled(GL_BLEND);
+		if (state.depthMask == UNKNOWN) {
+			GLboolean mask;
+			glGetBooleanv(GL_DEPTH_WRITEMASK, &mask);
+			state.depthMask = mask;
+		}
+		if (state.blendSrc == UNKNOWN || state.blendDst == UNKNOWN) {
+			// of draw buffer 0 if the buffers differ
+			GLint src, dst;
+			glGetIntegerv(GL_BLEND_SRC_RGB, &src);
+			glGetIntegerv(GL_BLEND_DST_RGB, &dst);
+			blendFunc(src, dst);
+		}
+		GLDepthBlendState saved;
+		saved.depthTest = state.depthTest;
+		saved.depthMask = state.depthMask;
+		saved.blend = state.blend;
+		saved.blendSrc = state.blendSrc;
+		saved.blendDst = state.blendDst;
+		return saved;
+	}
+	static void setDepthBlendState(const GLDepthBlendState& saved)
+	{
+		enable(GL_DEPTH_TEST, saved.depthTest);
+		depthMask(saved.depthMask);
+		enable(GL_BLEND, saved.blend);
+		blendFunc(saved.blendSrc, saved.blendDst);
+	}
+
+	// Deleted names can be handed out again by glGen*, drop them from the
+	// shadow so a new object with the same name still gets bound
+	static void deleteProgram(GLuint program)
+	{
+		if (state.program == program)
+			state.program = UNKNOWN;
+		glDeleteProgram(program);
+	}
+	static void deleteVertexArray(GLuint vao)
+	{
+		// GL falls back to vertex array 0 when the bound one is deleted
+		if (state.vertexArray == vao)
+			state.vertexArray = 0;
+		glDeleteVertexArrays(1, &vao);
+	}
+	static void deleteTexture(GLuint texture)
+	{
+		// and unbinds a deleted texture from every unit
+		for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+			for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+				if (state.textures[unit][target] == texture)
+					state.textures[unit][target] = 0;
+		glDeleteTextures(1, &texture);
+	}
+
+	// Forget everything, the next call of each kind is always issued
+	static void invalidate()
+	{
+		state = State();
+	}
+
+	static const GLStateCounters& counters() { return stats; }
+	static void resetCounters() { stats = GLStateCounters(); }
+
+private:
+	static const GLuint UNKNOWN = 0xFFFFFFFF;
+	static const unsigned int TEXTURE_TARGETS = 2;	// 2D and cube map
+
+	struct State
+	{
+		GLuint program = UNKNOWN;
+		GLuint vertexArray = UNKNOWN;
+		unsigned int activeUnit = UNKNOWN;
+		GLuint textures[MAX_TEXTURE_UNITS][TEXTURE_TARGETS];
+		GLuint stencilMask = 0;
+		bool stencilMaskValid = false;
+		GLuint depthTest = UNKNOWN;
+		GLuint blend = UNKNOWN;
+		GLuint depthMask = UNKNOWN;
+		GLenum blendSrc = UNKNOWN, blendDst = UNKNOWN;
+
+		State()
+		{
+			for (unsigned int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+				for (unsigned int target = 0; target < TEXTURE_TARGETS; target++)
+					textures[unit][target] = UNKNOWN;
+		}
+	};
+
+	inline static State state;
+	inline static GLStateCounters stats = GLStateCounters();
+
+	// Counts the call, returns true when it can be skipped
+	static bool track(GLStateCall call, bool redundant)
+	{
+		if (redundant)
+			stats.elided[call]++;
+		else
+			stats.issued[call]++;
+		return redundant;
+	}
+	static GLuint* capabilitySlot(GLenum capability)
+	{
+		if (capability == GL_DEPTH_TEST)
+			return &state.depthTest;
+		if (capability == GL_BLEND)
+			return &state.blend;
+		return nullptr;
+	}
+	// Tracked binding of target on unit, null for untracked targets and units
+	static GLuint* textureSlot(GLenum target, unsigned int unit)
+	{
+		if (unit >= MAX_TEXTURE_UNITS)
+			return nullptr;
+		if (target == GL_TEXTURE_2D)
+			return &state.textures[unit][0];
+		if (target == GL_TEXTURE_CUBE_MAP)
+			return &state.textures[unit][1];
+		return nullptr;
+	}
+};
+
+#endif // !GL_STATE_H
@@ -0,0 +1,91 @@
+#include "glext.h"
+
+#include <cstring>
+
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = NULL;
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = NULL;
+PFNGLTEXSTORAGE2DPROC glext_glTexStorage2D = NULL;
+PFNGLBLENDFUNCIPROC glext_glBlendFunci = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = NULL;
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = NULL;
+PFNGLCLEARBUFFERDATAPROC glext_glClearBufferData = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC glext_glMultiDrawElementsIndirectCount = NULL;
+
+GLExtensions GLExt = {};
+
+bool hasGLExtension(const char* name)
+{
+	GLint count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (GLint i = 0; i < count; i++) {
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension && std::strcmp(extension, name) == 0)
+			return true;
+	}
+	return false;
+}
+
+static bool atLeast(int major, int minor)
+{
+	return GLExt.major > major || (GLExt.major == major && GLExt.minor >= minor);
+}
+
+void loadGLExtensions(GLADloadproc load)
+{
+	GLExt = GLExtensions();
+	glGetIntegerv(GL_MAJOR_VERSION, &GLExt.major);
+	glGetIntegerv(GL_MINOR_VERSION, &GLExt.minor);
+
+	// program binaries
+	if (atLeast(4, 1) || hasGLExtension("GL_ARB_get_program_binary")) {
+		glext_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+		glext_glProgramBinary = (PFNGLPROGRAMBINARYPROC)load("glProgramBinary");
+		glext_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		GLExt.programBinary = glext_glGetProgramBinary && glext_glProgramBinary && glext_glProgramParameteri && formats > 0;
+	}
+
+	// parallel shader compile
+	if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+		glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+	else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+		glext_glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+	GLExt.parallelShaderCompile = glext_glMaxShaderCompilerThreadsKHR != NULL;
+
+	// immutable textures
+	if (atLeast(4, 2) || hasGLExtension("GL_ARB_texture_storage"))
+		glext_glTexStorage2D = (PFNGLTEXSTORAGE2DPROC)load("glTexStorage2D");
+	GLExt.textureStorage = glext_glTexStorage2D != NULL;
+
+	// blend function per draw buffer
+	if (atLeast(4, 0))
+		glext_glBlendFunci = (PFNGLBLENDFUNCIPROC)load("glBlendFunci");
+	else if (hasGLExtension("GL_ARB_draw_buffers_blend"))
+		glext_glBlendFunci = (PFNGLBLENDFUNCIPROC)load("glBlendFunciARB");
+	GLExt.drawBuffersBlend = glext_glBlendFunci != NULL;
+
+	// multi draw indirect with storage buffers, the shaders index their
+	// per draw data with gl_DrawID
+	if (atLeast(4, 3) && (atLeast(4, 6) || hasGLExtension("GL_ARB_shader_draw_parameters")))
+		glext_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+	GLExt.multiDrawIndirect = glext_glMultiDrawElementsIndirect != NULL;
+
+	// compute shaders
+	if (atLeast(4, 3)) {
+		glext_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+		glext_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+		glext_glClearBufferData = (PFNGLCLEARBUFFERDATAPROC)load("glClearBufferData");
+	}
+	GLExt.computeShader = glext_glDispatchCompute && glext_glMemoryBarrier && glext_glClearBufferData;
+
+	// draw count read from a buffer
+	if (atLeast(4, 6))
+		glext_glMultiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load("glMultiDrawElementsIndirectCount");
+	else if (hasGLExtension("GL_ARB_indirect_parameters"))
+		glext_glMultiDrawElementsIndirectCount = (PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)load("glMultiDrawElementsIndirectCountARB");
+	GLExt.indirectCount = glext_glMultiDrawElementsIndirectCount != NULL;
+}
@@ -0,0 +1,87 @@
+#ifndef GLEXT_H
+#define GLEXT_H
+
+#include <glad/glad.h>
+
+// GL entry points and enums newer than the 3.3 core profile GLAD was
+// generated for. They are loaded by loadGLExtensions() after GLAD; every
+// pointer may be null, check the matching GLExt flag before use.
+
+// GL 4.1 / ARB_get_program_binary
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+extern PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC glext_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri;
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+
+// KHR_parallel_shader_compile (ARB_parallel_shader_compile uses the same enums)
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+extern PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR;
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+
+// GL 4.2 / ARB_texture_storage
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+extern PFNGLTEXSTORAGE2DPROC glext_glTexStorage2D;
+#define glTexStorage2D glext_glTexStorage2D
+
+// GL 4.0 / ARB_draw_buffers_blend
+typedef void (APIENTRYP PFNGLBLENDFUNCIPROC)(GLuint buf, GLenum src, GLenum dst);
+extern PFNGLBLENDFUNCIPROC glext_glBlendFunci;
+#define glBlendFunci glext_glBlendFunci
+
+// GL 4.3 / ARB_multi_draw_indirect, ARB_shader_storage_buffer_object
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+
+// GL 4.3 / ARB_compute_shader, ARB_clear_buffer_object
+#define GL_COMPUTE_SHADER 0x91B9
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLCLEARBUFFERDATAPROC)(GLenum target, GLenum internalformat, GLenum format, GLenum type, const void* data);
+extern PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier;
+extern PFNGLCLEARBUFFERDATAPROC glext_glClearBufferData;
+#define glDispatchCompute glext_glDispatchCompute
+#define glMemoryBarrier glext_glMemoryBarrier
+#define glClearBufferData glext_glClearBufferData
+
+// GL 4.6 / ARB_indirect_parameters
+#define GL_PARAMETER_BUFFER 0x80EE
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC)(GLenum mode, GLenum type, const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride);
+extern PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC glext_glMultiDrawElementsIndirectCount;
+#define glMultiDrawElementsIndirectCount glext_glMultiDrawElementsIndirectCount
+
+struct GLExtensions
+{
+	int major, minor;		// context version
+	bool programBinary;		// GL 4.1 or ARB_get_program_binary with at least one format
+	bool parallelShaderCompile;	// KHR/ARB_parallel_shader_compile
+	bool textureStorage;		// GL 4.2 or ARB_texture_storage
+	bool drawBuffersBlend;		// GL 4.0 or ARB_draw_buffers_blend
+	bool multiDrawIndirect;		// GL 4.3 with gl_DrawID (GL 4.6 or ARB_shader_draw_parameters)
+	bool computeShader;		// GL 4.3, compute shaders and glClearBufferData
+	bool indirectCount;		// GL 4.6 or ARB_indirect_parameters
+};
+extern GLExtensions GLExt;
+
+// Whether the context advertises the named extension
+bool hasGLExtension(const char* name);
+// Load the entry points above and fill GLExt. Call once the context is
+// current and GLAD is loaded.
+void loadGLExtensions(GLADloadproc load);
+
+#endif // !GLEXT_H
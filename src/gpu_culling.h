@@ -0,0 +1,257 @@
+#ifndef GPU_CULLING_H
+#define GPU_CULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "culling.h"
+#include "glext.h"
+#include "hiz.h"
+#include "indirect_draw.h"
+#include "shader.h"
+
+// Frustum culling of indirect draws in a compute shader. The draws are
+// uploaded with their object space bounds, cull() tests them in cull.comp
+// and compacts the survivors of each bucket to the front of the bucket's
+// range in the command buffer, their DrawData next to them for
+// indirect.vert. Nothing is read back: draw() takes the count from the GPU
+// (GL 4.6 or ARB_indirect_parameters) or submits the whole range, the
+// cleared commands past the survivors draw no instances.
+//
+// A bucket is a run of draws sharing state a multi draw cannot change,
+// such as the textures of a material.
+//
+// With a depth pyramid draws are also tested for occlusion, against depth
+// from an earlier frame. Objects that just came into view would pop in a
+// frame late, so those rejected for occlusion alone get a second chance in
+// retest(), against a pyramid of the depth drawn so far this frame.
+//
+// The uniform handles of cull.comp are looked up once per program, see
+// UniformBindings.
+class GPUCuller
+{
+public:
+	// Handles of the cull.comp uniforms, and of drawOffset in the
+	// indirect.vert programs of draw(), -1 where unused
+	struct Bindings
+	{
+		int planes[6];
+		int objectCount, phase, occlusion;
+		int hiz, hizViewProjection, hizLevels;
+		int drawOffset;
+
+		void resolve(const Shader& shader)
+		{
+			for (int p = 0; p < 6; p++)
+				planes[p] = shader.uniform("planes[" + std::to_string(p) + "]");
+			objectCount = shader.uniform("objectCount");
+			phase = shader.uniform("phase");
+			occlusion = shader.uniform("occlusion");
+			hiz = shader.uniform("hiz");
+			hizViewProjection = shader.uniform("hizViewProjection");
+			hizLevels = shader.uniform("hizLevels");
+			drawOffset = shader.uniform("drawOffset");
+		}
+	};
+
+	GPUCuller() : objectBuffer(0), drawBuffer(0), visibleBuffer(0), commandBuffer(0), countBuffer(0), retestBuffer(0),
+		capacity(0), bucketCapacity(0) {}
+
+	// Compute shaders and multi draw indirect with gl_DrawID
+	static bool supported() { return GLExt.computeShader && GLExt.multiDrawIndirect; }
+
+	void clear()
+	{
+		objects.clear();
+		draws.clear();
+		buckets.clear();
+	}
+	// Draws of one bucket are added one after the other, key names the
+	// bucket for the caller
+	void add(const DrawCommand& command, const DrawData& draw, const MeshBounds& bounds, unsigned int key)
+	{
+		if (buckets.empty() || buckets.back().key != key) {
+			Bucket bucket;
+			bucket.key = key;
+			bucket.first = objects.size();
+			bucket.size = 0;
+			buckets.push_back(bucket);
+		}
+		CullObject object;
+		object.boundsMin = glm::vec4(bounds.min, bounds.radius);
+		object.boundsMax = glm::vec4(bounds.max, 0.0f);
+		object.count = command.count;
+		object.firstIndex = command.firstIndex;
+		object.baseVertex = command.baseVertex;
+		object.bucket = buckets.size() - 1;
+		object.bucketFirst = buckets.back().first;
+		buckets.back().size++;
+		objects.push_back(object);
+		draws.push_back(draw);
+	}
+	unsigned int size() const { return objects.size(); }
+
+	// Send the draws added since clear(), again after they changed
+	void upload()
+	{
+		if (!objectBuffer) {
+			glGenBuffers(1, &objectBuffer);
+			glGenBuffers(1, &drawBuffer);
+			glGenBuffers(1, &visibleBuffer);
+			glGenBuffers(1, &commandBuffer);
+			glGenBuffers(1, &countBuffer);
+			glGenBuffers(1, &retestBuffer);
+		}
+		if (objects.size() > capacity) {
+			capacity = objects.size();
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawData), NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(DrawCommand), NULL, GL_DYNAMIC_COPY);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, retestBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(unsigned int), NULL, GL_DYNAMIC_COPY);
+		}
+		if (buckets.size() > bucketCapacity) {
+			bucketCapacity = buckets.size();
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, bucketCapacity * sizeof(unsigned int), NULL, GL_DYNAMIC_COPY);
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, objects.size() * sizeof(CullObject), objects.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(DrawData), draws.data(), GL_DYNAMIC_DRAW);
+	}
+
+	// Test every draw against frustum and, when given a built pyramid, for
+	// occlusion. shader is the cull.comp program.
+	void cull(Shader& shader, const Frustum& frustum, const HiZPyramid* hiz = NULL)
+	{
+		if (objects.empty())
+			return;
+		shader.use();
+		const Bindings& b = bindings(shader);
+		for (int p = 0; p < 6; p++)
+			shader.setVec4(b.planes[p], frustum.planes[p]);
+		dispatch(shader, 0, hiz && hiz->valid() ? hiz : NULL);
+	}
+	// After the draws of cull(): test the draws it found occluded against
+	// hiz, built from the current depth. Draw the survivors as well.
+	void retest(Shader& shader, const HiZPyramid& hiz)
+	{
+		if (objects.empty())
+			return;
+		shader.use();
+		dispatch(shader, 1, &hiz);
+	}
+
+	// Draws the last cull() found occluded that retest() did not bring back.
+	// Reads back from the GPU and waits for it, for statistics only.
+	unsigned int occludedCount() const
+	{
+		if (objects.empty())
+			return 0;
+		std::vector<unsigned int> flags(objects.size());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, retestBuffer);
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, flags.size() * sizeof(unsigned int), flags.data());
+		return std::count(flags.begin(), flags.end(), 1u);
+	}
+
+	unsigned int bucketCount() const { return buckets.size(); }
+	unsigned int bucketKey(unsigned int bucket) const { return buckets[bucket].key; }
+	// What survived cull() in one bucket, with the vertex array of the draws
+	// and a program built from indirect.vert bound
+	void draw(const Shader& shader, unsigned int bucket) const
+	{
+		const Bucket& b = buckets[bucket];
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, visibleBuffer);
+		shader.setInt(bindings(shader).drawOffset, b.first);
+		const void* commands = (const void*)(b.first * sizeof(DrawCommand));
+		if (GLExt.indirectCount) {
+			glBindBuffer(GL_PARAMETER_BUFFER, countBuffer);
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, commands, bucket * sizeof(unsigned int), b.size, 0);
+		}
+		else
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, commands, b.size, 0);
+	}
+
+	void Delete()
+	{
+		glDeleteBuffers(1, &objectBuffer);
+		glDeleteBuffers(1, &drawBuffer);
+		glDeleteBuffers(1, &visibleBuffer);
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteBuffers(1, &countBuffer);
+		glDeleteBuffers(1, &retestBuffer);
+		objectBuffer = drawBuffer = visibleBuffer = commandBuffer = countBuffer = retestBuffer = 0;
+		capacity = bucketCapacity = 0;
+	}
+
+	const Bindings& bindings(const Shader& shader) const { return programs.get(shader); }
+
+private:
+	// std430 layout of CullObject in cull.comp
+	struct CullObject
+	{
+		glm::vec4 boundsMin;	// w is the sphere radius
+		glm::vec4 boundsMax;
+		unsigned int count;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int bucket;
+		unsigned int bucketFirst;
+		unsigned int padding[3];
+	};
+	struct Bucket
+	{
+		unsigned int key;
+		unsigned int first, size;
+	};
+
+	// One pass of cull.comp over every draw
+	void dispatch(Shader& shader, int phase, const HiZPyramid* hiz)
+	{
+		const unsigned int zero = 0;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, countBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		if (!GLExt.indirectCount) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+			glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, visibleBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, objectBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, drawBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, countBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, retestBuffer);
+		const Bindings& b = bindings(shader);
+		shader.setInt(b.objectCount, objects.size());
+		shader.setInt(b.phase, phase);
+		shader.setBool(b.occlusion, hiz != NULL);
+		if (hiz) {
+			shader.setInt(b.hiz, 0);
+			GLState::bindTexture(GL_TEXTURE_2D, 0, hiz->texture());
+			shader.setMat4(b.hizViewProjection, hiz->seenWith());
+			shader.setInt(b.hizLevels, hiz->levelCount());
+		}
+		glDispatchCompute((objects.size() + 63) / 64, 1, 1);
+		// commands and counts are read by the draws, DrawData by indirect.vert
+		glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	std::vector<CullObject> objects;
+	std::vector<DrawData> draws;
+	std::vector<Bucket> buckets;
+	unsigned int objectBuffer, drawBuffer;		// input
+	unsigned int visibleBuffer, commandBuffer;	// output, capacity draws each
+	unsigned int countBuffer;					// survivors per bucket
+	unsigned int retestBuffer;					// flag per draw, see cull.comp
+	size_t capacity, bucketCapacity;
+	UniformBindings<Bindings> programs;
+};
+
+#endif // !GPU_CULLING_H
@@ -0,0 +1,227 @@
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fbo.h"
+#include "rbo.h"
+#include "camera.h"
+#include "context.h"
+#include "renderer.h"
+#include "program_cache.h"
+#include "gl_state.h"
+#include "texture_cache.h"
+
+#ifndef OGL_ASSET_DIR
+#define OGL_ASSET_DIR "../../../src/"
+#endif
+
+// Offscreen runner: renders a fixed number of frames without a display,
+// prints frame timings and optionally writes the last frame as a PPM.
+struct HeadlessOptions
+{
+	ContextBackend backend = CONTEXT_EGL;
+	unsigned int width = 1280;
+	unsigned int height = 720;
+	unsigned int frames = 100;
+	unsigned int warmup = 5;
+	std::string assets = OGL_ASSET_DIR;
+	std::string output;
+	std::string shaderCache;
+	bool zoom = false;
+	bool oit = false;
+	bool gpuCulling = false;
+	bool occlusionCulling = false;
+	bool keepGeometry = false;
+	bool textureHashing = false;
+	bool benchmarkScene = false;
+};
+
+static void printUsage(const char* exe)
+{
+	std::cout << "usage: " << exe << " [options]\n"
+		<< "  --backend egl|osmesa|glfw  context backend (default egl)\n"
+		<< "  --width N --height N       render target size (default 1280x720)\n"
+		<< "  --frames N                 timed frames (default 100)\n"
+		<< "  --warmup N                 untimed frames before timing (default 5)\n"
+		<< "  --assets DIR               directory holding shaders/ textures/ models/\n"
+		<< "  --output FILE.ppm          write the last frame\n"
+		<< "  --shader-cache DIR         keep linked program binaries in DIR\n"
+		<< "  --zoom                     composite the mirror pass\n"
+		<< "  --oit                      weighted blended transparency for the vegetation\n"
+		<< "  --gpu-culling              cull the model and the blocks in a compute shader\n"
+		<< "  --occlusion-culling        GPU culling against the depth of the previous frame\n"
+		<< "  --keep-geometry            keep compressed model geometry in system memory\n"
+		<< "  --texture-hashing          share identical texture files by content\n"
+		<< "  --benchmark-scene          add objects that exercise the culling paths" << std::endl;
+}
+
+static bool parseOptions(int argc, char** argv, HeadlessOptions& options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--backend" && hasValue) {
+			if (!parseContextBackend(argv[++i], options.backend)) {
+				std::cout << "Unknown backend: " << argv[i] << std::endl;
+				return false;
+			}
+		}
+		else if (arg == "--width" && hasValue)
+			options.width = std::atoi(argv[++i]);
+		else if (arg == "--height" && hasValue)
+			options.height = std::atoi(argv[++i]);
+		else if (arg == "--frames" && hasValue)
+			options.frames = std::atoi(argv[++i]);
+		else if (arg == "--warmup" && hasValue)
+			options.warmup = std::atoi(argv[++i]);
+		else if (arg == "--assets" && hasValue)
+			options.assets = argv[++i];
+		else if (arg == "--output" && hasValue)
+			options.output = argv[++i];
+		else if (arg == "--shader-cache" && hasValue)
+			options.shaderCache = argv[++i];
+		else if (arg == "--zoom")
+			options.zoom = true;
+		else if (arg == "--oit")
+			options.oit = true;
+		else if (arg == "--gpu-culling")
+			options.gpuCulling = true;
+		else if (arg == "--occlusion-culling")
+			options.occlusionCulling = true;
+		else if (arg == "--keep-geometry")
+			options.keepGeometry = true;
+		else if (arg == "--texture-hashing")
+			options.textureHashing = true;
+		else if (arg == "--benchmark-scene")
+			options.benchmarkScene = true;
+		else
+			return false;
+	}
+	if (!options.assets.empty() && options.assets.back() != '/')
+		options.assets += '/';
+	return options.width > 0 && options.height > 0;
+}
+
+static bool writePPM(const std::string& path, unsigned int width, unsigned int height)
+{
+	std::vector<unsigned char> pixels((size_t)width * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	file << "P6\n" << width << " " << height << "\n255\n";
+	// GL rows are bottom up
+	for (unsigned int y = height; y-- > 0;)
+		file.write((const char*)&pixels[(size_t)y * width * 3], width * 3);
+	return (bool)file;
+}
+
+int main(int argc, char** argv)
+{
+	HeadlessOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	std::unique_ptr<Context> context = createContextAndLoadGL(options.backend, options.width, options.height, "OGL_headless");
+	if (!context)
+		return 1;
+	std::cout << context->name() << ": " << glGetString(GL_RENDERER) << " | " << glGetString(GL_VERSION) << std::endl;
+
+	// Offscreen render target, surfaceless contexts have no framebuffer 0
+	FBO target = FBO();
+	target.bind();
+	RBO color = RBO(options.width, options.height, GL_RGBA8);
+	color.attach(GL_COLOR_ATTACHMENT0);
+	RBO depth = RBO(options.width, options.height, GL_DEPTH24_STENCIL8);
+	depth.attach(GL_DEPTH_STENCIL_ATTACHMENT);
+	target.check_status();
+	target.unbind();
+
+	Camera camera(glm::vec3(1.0f, 1.5f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), -100, -20);
+	{
+		ProgramCache::setDirectory(options.shaderCache);
+		TextureCache::shared().setContentHashing(options.textureHashing);
+		std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+		Renderer renderer(options.assets, options.width, options.height, options.benchmarkScene ? SCENE_BENCHMARK : SCENE_DEMO);
+		std::cout << "scene loaded in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms"
+			<< ", programs ready " << renderer.programsReady() << ", compiling " << renderer.programsCompiling() << std::endl;
+		// textures stream in, wait so every timed frame is complete
+		renderer.setKeepCompressedGeometry(options.keepGeometry);
+		renderer.finishLoading();
+		std::cout << "textures resident after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count() << " ms"
+			<< ", model in system memory " << renderer.geometryBytes() / 1024 << " KB" << std::endl;
+		TextureCache& textures = TextureCache::shared();
+		std::cout << "texture cache: " << textures.size() << " textures, hits " << textures.hits()
+			<< ", misses " << textures.misses() << std::endl;
+		renderer.setTarget(target.id);
+		renderer.setWeightedTransparency(options.oit);
+		if (!renderer.setGPUCulling(options.gpuCulling || options.occlusionCulling) ||
+			!renderer.setOcclusionCulling(options.occlusionCulling)) {
+			std::cout << "GPU culling needs compute shaders and multi draw indirect" << std::endl;
+			return 1;
+		}
+
+		for (unsigned int i = 0; i < options.warmup; i++)
+			renderer.renderFrame(camera, options.zoom);
+		glFinish();
+		GLState::resetCounters();
+		renderer.resetCullingCounters();
+		unsigned int nodesBefore = renderer.updatedNodes();
+
+		// glFinish per frame so the timings include GPU work
+		std::vector<double> times;
+		times.reserve(options.frames);
+		for (unsigned int i = 0; i < options.frames; i++) {
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			renderer.renderFrame(camera, options.zoom);
+			glFinish();
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		if (!times.empty()) {
+			double total = 0.0, best = times[0], worst = times[0];
+			for (double t : times) {
+				total += t;
+				best = t < best ? t : best;
+				worst = t > worst ? t : worst;
+			}
+			std::cout << options.frames << " frames at " << options.width << "x" << options.height
+				<< ": avg " << total / times.size() << " ms, min " << best << " ms, max " << worst << " ms" << std::endl;
+			const GLStateCounters& calls = GLState::counters();
+			std::cout << "state calls per frame: issued " << calls.totalIssued() / times.size()
+				<< ", elided " << calls.totalElided() / times.size() << std::endl;
+			std::cout << "culling per frame: visible " << renderer.visibleObjects() / times.size()
+				<< ", culled " << renderer.culledObjects() / times.size() << std::endl;
+			std::cout << "scene graph nodes updated per frame: " << (renderer.updatedNodes() - nodesBefore) / times.size() << std::endl;
+			if (options.occlusionCulling)
+				std::cout << "occluded draws in the last view: " << renderer.occludedObjects() << std::endl;
+		}
+
+		if (!options.output.empty()) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, target.id);
+			if (!writePPM(options.output, options.width, options.height))
+				std::cout << "Failed to write " << options.output << std::endl;
+		}
+	}
+	color.Delete();
+	depth.Delete();
+	target.Delete();
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		std::cout << "GL error 0x" << std::hex << error << std::dec << std::endl;
+		return 1;
+	}
+	return 0;
+}
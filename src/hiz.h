@@ -0,0 +1,193 @@
+#ifndef HIZ_H
+#define HIZ_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+
+#include "gl_state.h"
+#include "shader.h"
+
+// Hierarchical depth of one view: a mip chain where every texel holds the
+// farthest depth of the texels under it, level 0 at half the view size.
+// Bounds whose nearest depth is behind the farthest depth of the few texels
+// covering them are hidden. The depth comes from a view that was already
+// drawn, usually the previous frame, so the view projection it was seen
+// with is kept to project bounds into it.
+class HiZPyramid
+{
+public:
+	HiZPyramid() : depthFBO(0), depth(0), pyramidFBO(0), pyramid(0), vao(0), width(0), height(0), levels(0),
+		depthFormat(GL_NONE), built(false) {}
+
+	// Reduce the depth of target (width x height) seen with viewProjection.
+	// shader is the hiz program (oit_composite.vert and hiz.frag). Leaves
+	// target bound with a full viewport. Returns false, and builds nothing,
+	// when target has no depth buffer the copy can match.
+	bool build(unsigned int target, unsigned int width, unsigned int height, const glm::mat4& viewProjection, Shader& shader)
+	{
+		// renderbuffers cannot be sampled, copy the depth to a texture. The
+		// blit needs the same format on both sides, a window's depth
+		// buffer is whatever the driver picked.
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+		GLenum format = depthFormatOf(target);
+		if (format == GL_NONE) {
+			glBindFramebuffer(GL_FRAMEBUFFER, target);
+			std::cout << "ERROR::HIZ::Unsupported depth format of framebuffer " << target << std::endl;
+			built = false;
+			return false;
+		}
+		if (width != this->width || height != this->height || format != depthFormat)
+			allocate(width, height, format);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFBO);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, pyramidFBO);
+		GLDepthBlendState saved = GLState::depthBlendState();
+		GLState::enable(GL_DEPTH_TEST, false);
+		GLState::enable(GL_BLEND, false);
+		shader.use();
+		shader.setInt("source", 0);
+		GLState::bindVertexArray(vao);
+		unsigned int sourceWidth = width, sourceHeight = height;
+		for (unsigned int level = 0; level < levels; level++) {
+			// the level written must not be one the shader can read
+			if (level == 0)
+				GLState::bindTexture(GL_TEXTURE_2D, 0, depth);
+			else {
+				GLState::bindTexture(GL_TEXTURE_2D, 0, pyramid);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			}
+			unsigned int levelWidth = std::max(sourceWidth / 2, 1u), levelHeight = std::max(sourceHeight / 2, 1u);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, level);
+			glViewport(0, 0, levelWidth, levelHeight);
+			shader.setVec2("sourceSize", glm::vec2(sourceWidth, sourceHeight));
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			sourceWidth = levelWidth;
+			sourceHeight = levelHeight;
+		}
+		GLState::bindTexture(GL_TEXTURE_2D, 0, pyramid);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, target);
+		glViewport(0, 0, width, height);
+		GLState::setDepthBlendState(saved);
+		this->viewProjection = viewProjection;
+		built = true;
+		return true;
+	}
+
+	// Whether build() ran since the last resize
+	bool valid() const { return built; }
+	unsigned int texture() const { return pyramid; }
+	unsigned int levelCount() const { return levels; }
+	const glm::mat4& seenWith() const { return viewProjection; }
+
+	void Delete()
+	{
+		release();
+		if (vao)
+			GLState::deleteVertexArray(vao);
+		vao = 0;
+	}
+
+private:
+	unsigned int depthFBO, depth;		// copy of the view's depth
+	unsigned int pyramidFBO, pyramid;	// R32F with levels mips
+	unsigned int vao;					// empty, for the full screen triangle
+	unsigned int width, height;
+	unsigned int levels;
+	GLenum depthFormat;					// of depth, matches the last target
+	glm::mat4 viewProjection;
+	bool built;
+
+	// Sized format of the depth buffer of the framebuffer bound for reading,
+	// GL_NONE without one or for formats not listed
+	static GLenum depthFormatOf(unsigned int target)
+	{
+		// the default framebuffer names its buffers, not attachments
+		GLenum attachment = target == 0 ? GL_DEPTH : GL_DEPTH_ATTACHMENT;
+		GLint type = GL_NONE;
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+		if (type == GL_NONE)
+			return GL_NONE;
+		GLint depthBits = 0, stencilBits = 0, component = GL_NONE;
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE, &depthBits);
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &stencilBits);
+		glGetFramebufferAttachmentParameteriv(GL_READ_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_COMPONENT_TYPE, &component);
+		if (component == GL_FLOAT && depthBits == 32)
+			return stencilBits > 0 ? GL_DEPTH32F_STENCIL8 : GL_DEPTH_COMPONENT32F;
+		if (stencilBits > 0)
+			return depthBits == 24 ? GL_DEPTH24_STENCIL8 : GL_NONE;
+		switch (depthBits) {
+		case 16: return GL_DEPTH_COMPONENT16;
+		case 24: return GL_DEPTH_COMPONENT24;
+		case 32: return GL_DEPTH_COMPONENT32;
+		default: return GL_NONE;
+		}
+	}
+
+	void allocate(unsigned int width, unsigned int height, GLenum format)
+	{
+		release();
+		this->width = width;
+		this->height = height;
+		depthFormat = format;
+		bool stencil = format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+		// no data is uploaded, any matching format and type do
+		GLenum type = format == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8
+			: format == GL_DEPTH32F_STENCIL8 ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV
+			: format == GL_DEPTH_COMPONENT32F ? GL_FLOAT : GL_UNSIGNED_INT;
+		glGenTextures(1, &depth);
+		GLState::bindTexture(GL_TEXTURE_2D, depth);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, stencil ? GL_DEPTH_STENCIL : GL_DEPTH_COMPONENT, type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glGenFramebuffers(1, &depthFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::HIZ::Depth framebuffer is not complete!" << std::endl;
+
+		glGenTextures(1, &pyramid);
+		GLState::bindTexture(GL_TEXTURE_2D, pyramid);
+		levels = 0;
+		for (unsigned int w = std::max(width / 2, 1u), h = std::max(height / 2, 1u); ; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+			glTexImage2D(GL_TEXTURE_2D, levels++, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, NULL);
+			if (w == 1 && h == 1)
+				break;
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+		glGenFramebuffers(1, &pyramidFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, pyramidFBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramid, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::HIZ::Pyramid framebuffer is not complete!" << std::endl;
+		if (!vao)
+			glGenVertexArrays(1, &vao);
+	}
+	void release()
+	{
+		if (depthFBO) {
+			glDeleteFramebuffers(1, &depthFBO);
+			glDeleteFramebuffers(1, &pyramidFBO);
+			GLState::deleteTexture(depth);
+			GLState::deleteTexture(pyramid);
+		}
+		depthFBO = depth = pyramidFBO = pyramid = 0;
+		width = height = levels = 0;
+		depthFormat = GL_NONE;
+		built = false;
+	}
+};
+
+#endif // !HIZ_H
@@ -0,0 +1,26 @@
+#ifndef INDIRECT_DRAW_H
+#define INDIRECT_DRAW_H
+
+#include <glm/glm.hpp>
+
+// Layout of glMultiDrawElementsIndirect
+struct DrawCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+// Per draw data of a multi draw, std430 layout of DrawData in indirect.vert
+// and cull.comp
+struct DrawData
+{
+	glm::mat4 model;
+	glm::vec4 normalMatrix[3];	// mat3 columns
+	unsigned int material;
+	unsigned int padding[3];
+};
+
+#endif // !INDIRECT_DRAW_H
@@ -0,0 +1,76 @@
+#ifndef INSTANCES_H
+#define INSTANCES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+// Attribute locations of the per instance data, after position, normal and
+// texture coordinates. A mat4 takes four locations, one per column.
+const unsigned int INSTANCE_MODEL_LOCATION = 3;
+const unsigned int INSTANCE_TINT_LOCATION = 7;
+
+struct InstanceData
+{
+	glm::mat4 model;
+	glm::vec4 tint;
+};
+
+// Per instance transforms and tints for instanced draws. The shaders
+// compiled with INSTANCED read them as attributes that advance once per
+// instance; attach() adds them to the bound VAO. Refilled every frame,
+// upload() orphans the old storage so the GPU is never waited on.
+class InstanceBuffer
+{
+public:
+	unsigned int id;
+
+	InstanceBuffer() : capacity(0) {
+		glGenBuffers(1, &id);
+	}
+
+	void clear() { instances.clear(); }
+	unsigned int add(const glm::mat4& model, const glm::vec4& tint = glm::vec4(1.0f)) {
+		InstanceData instance;
+		instance.model = model;
+		instance.tint = tint;
+		instances.push_back(instance);
+		return instances.size() - 1;
+	}
+	unsigned int size() const { return instances.size(); }
+
+	void upload() {
+		glBindBuffer(GL_ARRAY_BUFFER, id);
+		if (instances.size() > capacity) {
+			capacity = instances.size();
+			glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), instances.data(), GL_STREAM_DRAW);
+			return;
+		}
+		glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+	}
+
+	// Point the instance attributes of the bound VAO at this buffer
+	void attach() const {
+		glBindBuffer(GL_ARRAY_BUFFER, id);
+		for (unsigned int i = 0; i < 4; i++) {
+			glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+				(void*)(offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+			glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+			glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+		}
+		glVertexAttribPointer(INSTANCE_TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, tint));
+		glEnableVertexAttribArray(INSTANCE_TINT_LOCATION);
+		glVertexAttribDivisor(INSTANCE_TINT_LOCATION, 1);
+	}
+
+	void Delete() { glDeleteBuffers(1, &id); }
+
+private:
+	std::vector<InstanceData> instances;
+	size_t capacity;	// in instances
+};
+
+#endif // !INSTANCES_H
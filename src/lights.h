@@ -0,0 +1,168 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glm/glm.hpp>
+
+#include <iostream>
+#include <vector>
+
+#include "ubo.h"
+
+// Must match shaders/lights.glsl
+const unsigned int LIGHTS_BINDING = 1;
+const unsigned int MAX_LIGHTS = 128;
+
+struct DirLight {
+    glm::vec3 direction;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+struct PointLight {
+    glm::vec3 position;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct SpotLight {
+    glm::vec3 position;
+    glm::vec3 direction;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float cutOff;       // cosine of the inner cone angle
+    float outerCutOff;  // cosine of the outer cone angle
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+// Owns the scene lights and packs them into the std140 Lights block. The
+// buffer is only rewritten by upload() after lights were added or changed,
+// so any number of programs can read them without per-frame uniform calls.
+class LightManager
+{
+public:
+    LightManager() : uploaded(0), buffer(sizeof(GPULights)), dirty(true) {}
+
+    // Add lights, the returned index is used to change them later
+    unsigned int addDirLight(const DirLight& light) { dirty = true; dirLights.push_back(light); return dirLights.size() - 1; }
+    unsigned int addPointLight(const PointLight& light) { dirty = true; pointLights.push_back(light); return pointLights.size() - 1; }
+    unsigned int addSpotLight(const SpotLight& light) { dirty = true; spotLights.push_back(light); return spotLights.size() - 1; }
+
+    // Mutable access marks the lights for upload
+    DirLight& dirLight(unsigned int i) { dirty = true; return dirLights[i]; }
+    PointLight& pointLight(unsigned int i) { dirty = true; return pointLights[i]; }
+    SpotLight& spotLight(unsigned int i) { dirty = true; return spotLights[i]; }
+
+    void clear()
+    {
+        dirLights.clear();
+        pointLights.clear();
+        spotLights.clear();
+        dirty = true;
+    }
+    unsigned int count() const { return dirLights.size() + pointLights.size() + spotLights.size(); }
+    // Directional, point and spot lights in the buffer after the last
+    // upload. Lights without any colour are left out, they add nothing.
+    glm::uvec3 uploadedCounts() const { return uploaded; }
+
+    // Attach the buffer to LIGHTS_BINDING and upload it if anything changed
+    void upload()
+    {
+        buffer.bindBase(LIGHTS_BINDING);
+        if (!dirty)
+            return;
+        dirty = false;
+        if (count() > MAX_LIGHTS)
+            std::cout << "WARNING::LIGHTS::" << count() << " lights exceed MAX_LIGHTS, extra lights are dropped" << std::endl;
+
+        unsigned int n = 0;
+        unsigned int counts[3] = { 0, 0, 0 };
+        for (unsigned int i = 0; i < dirLights.size() && n < MAX_LIGHTS; i++) {
+            const DirLight& l = dirLights[i];
+            if (isBlack(l.ambient, l.diffuse, l.specular))
+                continue;
+            n++, counts[0]++;
+            gpu.lights[n - 1] = GPULight();
+            gpu.lights[n - 1].direction = glm::vec4(l.direction, 0.0f);
+            setColors(gpu.lights[n - 1], l.ambient, l.diffuse, l.specular);
+        }
+        for (unsigned int i = 0; i < pointLights.size() && n < MAX_LIGHTS; i++) {
+            const PointLight& l = pointLights[i];
+            if (isBlack(l.ambient, l.diffuse, l.specular))
+                continue;
+            n++, counts[1]++;
+            gpu.lights[n - 1] = GPULight();
+            gpu.lights[n - 1].position = glm::vec4(l.position, 1.0f);
+            gpu.lights[n - 1].attenuation = glm::vec4(l.constant, l.linear, l.quadratic, 0.0f);
+            setColors(gpu.lights[n - 1], l.ambient, l.diffuse, l.specular);
+        }
+        for (unsigned int i = 0; i < spotLights.size() && n < MAX_LIGHTS; i++) {
+            const SpotLight& l = spotLights[i];
+            if (isBlack(l.ambient, l.diffuse, l.specular))
+                continue;
+            n++, counts[2]++;
+            gpu.lights[n - 1] = GPULight();
+            gpu.lights[n - 1].position = glm::vec4(l.position, 1.0f);
+            gpu.lights[n - 1].direction = glm::vec4(l.direction, 0.0f);
+            gpu.lights[n - 1].attenuation = glm::vec4(l.constant, l.linear, l.quadratic, 0.0f);
+            gpu.lights[n - 1].cone = glm::vec4(l.cutOff, l.outerCutOff, 0.0f, 0.0f);
+            setColors(gpu.lights[n - 1], l.ambient, l.diffuse, l.specular);
+        }
+        gpu.counts = glm::ivec4(counts[0], counts[1], counts[2], 0);
+        uploaded = glm::uvec3(counts[0], counts[1], counts[2]);
+        // only the used part of the array is sent
+        buffer.update(0, sizeof(glm::ivec4) + n * sizeof(GPULight), &gpu);
+    }
+
+    void Delete() { buffer.Delete(); }
+
+private:
+    // std140 layout of one entry of lights[]
+    struct GPULight {
+        glm::vec4 position = glm::vec4(0.0f);
+        glm::vec4 direction = glm::vec4(0.0f);
+        glm::vec4 ambient = glm::vec4(0.0f);
+        glm::vec4 diffuse = glm::vec4(0.0f);
+        glm::vec4 specular = glm::vec4(0.0f);
+        glm::vec4 attenuation = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        glm::vec4 cone = glm::vec4(0.0f);
+    };
+    struct GPULights {
+        glm::ivec4 counts;
+        GPULight lights[MAX_LIGHTS];
+    };
+
+    std::vector<DirLight> dirLights;
+    std::vector<PointLight> pointLights;
+    std::vector<SpotLight> spotLights;
+    GPULights gpu;
+    glm::uvec3 uploaded;
+    UBO buffer;
+    bool dirty;
+
+    static bool isBlack(const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular)
+    {
+        return ambient == glm::vec3(0.0f) && diffuse == glm::vec3(0.0f) && specular == glm::vec3(0.0f);
+    }
+    static void setColors(GPULight& light, const glm::vec3& ambient, const glm::vec3& diffuse, const glm::vec3& specular)
+    {
+        light.ambient = glm::vec4(ambient, 0.0f);
+        light.diffuse = glm::vec4(diffuse, 0.0f);
+        light.specular = glm::vec4(specular, 0.0f);
+    }
+};
+
+#endif // !LIGHTS_H
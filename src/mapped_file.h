@@ -0,0 +1,88 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The pages are only read in
+// when touched, so data can go from the page cache straight to the driver.
+class MappedFile
+{
+public:
+	MappedFile() : bytes(NULL), length(0) {}
+	MappedFile(const std::string& path) : bytes(NULL), length(0) { open(path); }
+	~MappedFile() { close(); }
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+			HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping) {
+				bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+				if (bytes)
+					length = (size_t)size.QuadPart;
+			}
+		}
+		CloseHandle(file);
+#else
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+		struct stat info;
+		if (fstat(file, &info) == 0 && info.st_size > 0) {
+			void* mapped = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (mapped != MAP_FAILED) {
+				bytes = (const unsigned char*)mapped;
+				length = info.st_size;
+			}
+		}
+		::close(file);
+#endif
+		return bytes != NULL;
+	}
+
+	void close()
+	{
+		if (!bytes)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(bytes);
+#else
+		munmap((void*)bytes, length);
+#endif
+		bytes = NULL;
+		length = 0;
+	}
+
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+	bool isOpen() const { return bytes != NULL; }
+
+private:
+	const unsigned char* bytes;
+	size_t length;
+};
+
+#endif // !MAPPED_FILE_H
@@ -0,0 +1,130 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "gl_state.h"
+#include "shader.h"
+#include "shader_variants.h"
+#include "texture_loader.h"
+
+// Texture maps of a material, the map is bound to the texture unit of the
+// same number
+enum MaterialMap {
+	MATERIAL_MAP_DIFFUSE,
+	MATERIAL_MAP_SPECULAR,
+	MATERIAL_MAP_COUNT
+};
+
+// Surface description from the asset (Ns and the maps of an MTL material).
+// Maps that are missing stay empty and are not bound.
+struct Material
+{
+	float shininess = 32.0f;
+	TextureHandle maps[MATERIAL_MAP_COUNT];
+
+	// "texture_diffuse" and "texture_specular" as written by the importer,
+	// MATERIAL_MAP_COUNT for anything else
+	static MaterialMap mapOf(const std::string& type)
+	{
+		if (type == "texture_diffuse")
+			return MATERIAL_MAP_DIFFUSE;
+		if (type == "texture_specular")
+			return MATERIAL_MAP_SPECULAR;
+		return MATERIAL_MAP_COUNT;
+	}
+};
+
+// Materials of a model addressed by index. The uniform handles a program
+// uses for materials are looked up once per program (UniformBindings),
+// binding a material is then a few integer uniform and texture binds, all
+// filtered by the shadow state of the shader and GLState. The program
+// variant that fits a material is picked once as well, see program().
+class MaterialLibrary
+{
+public:
+	// Handles of the material uniforms in one program, -1 where unused
+	struct Bindings
+	{
+		int maps[MATERIAL_MAP_COUNT];
+		int shininess;
+
+		void resolve(const Shader& shader)
+		{
+			maps[MATERIAL_MAP_DIFFUSE] = shader.uniform("material.texture_diffuse1");
+			maps[MATERIAL_MAP_SPECULAR] = shader.uniform("material.texture_specular1");
+			shininess = shader.uniform("material.shininess");
+		}
+	};
+
+	unsigned int add(const Material& material)
+	{
+		materials.push_back(material);
+		selections.push_back(std::vector<Selection>());
+		return materials.size() - 1;
+	}
+	unsigned int size() const { return materials.size(); }
+	const Material& get(unsigned int id) const { return materials[id]; }
+	Material& get(unsigned int id) { return materials[id]; }
+
+	const Bindings& bindings(const Shader& shader) const { return programs.get(shader); }
+
+	void bind(const Shader& shader, const Bindings& b, unsigned int id) const
+	{
+		const Material& material = materials[id];
+		for (unsigned int i = 0; i < MATERIAL_MAP_COUNT; i++) {
+			if (!material.maps[i])
+				continue;
+			shader.setInt(b.maps[i], i);
+			GLState::bindTexture(GL_TEXTURE_2D, i, material.maps[i]->id);
+		}
+		shader.setFloat(b.shininess, material.shininess);
+	}
+
+	// Variant of variants for material id: base with the features the
+	// material needs on top (a specular map). Cached per material and base,
+	// which only changes with the light counts, so this is a short search.
+	Shader& program(unsigned int id, ShaderVariants& variants, const ShaderFeatures& base)
+	{
+		uint32_t baseKey = base.key();
+		std::vector<Selection>& cached = selections[id];
+		for (unsigned int i = 0; i < cached.size(); i++)
+			if (cached[i].variants == &variants && cached[i].baseKey == baseKey)
+				return *cached[i].shader;
+		ShaderFeatures features = base;
+		features.specularMap = (bool)materials[id].maps[MATERIAL_MAP_SPECULAR];
+		Selection selection;
+		selection.variants = &variants;
+		selection.baseKey = baseKey;
+		selection.shader = &variants.get(features);
+		cached.push_back(selection);
+		return *selection.shader;
+	}
+
+	// System memory of the table, texture pixels are not counted
+	size_t cpuBytes() const
+	{
+		size_t bytes = materials.capacity() * sizeof(Material) + programs.size() * (sizeof(uint64_t) + sizeof(Bindings));
+		for (unsigned int i = 0; i < selections.size(); i++)
+			bytes += sizeof(std::vector<Selection>) + selections[i].capacity() * sizeof(Selection);
+		return bytes;
+	}
+
+private:
+	// Program picked for a material from one set of variants
+	struct Selection
+	{
+		const ShaderVariants* variants;
+		uint32_t baseKey;
+		Shader* shader;
+	};
+
+	std::vector<Material> materials;
+	std::vector<std::vector<Selection>> selections;	// by material
+	UniformBindings<Bindings> programs;
+};
+
+#endif // !MATERIAL_H
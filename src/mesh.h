@@ -8,10 +8,73 @@ struct Vertex {
     glm::vec2 TexCoords;
 };
 
-struct TextureData {
-    unsigned int id;
-    std::string type;
-    std::string path;
+// Object space bounds: a box and a sphere around the centre of the box
+struct MeshBounds {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+    float radius = 0.0f;
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+
+    static MeshBounds of(const Vertex* verts, size_t count) {
+        return of(&verts[0].Position.x, count, sizeof(Vertex) / sizeof(float));
+    }
+    // Positions every stride floats, as in the interleaved arrays of the renderer
+    static MeshBounds of(const float* positions, size_t count, size_t stride) {
+        MeshBounds bounds;
+        if (count == 0)
+            return bounds;
+        bounds.min = bounds.max = glm::make_vec3(positions);
+        for (size_t i = 1; i < count; i++) {
+            bounds.min = glm::min(bounds.min, glm::make_vec3(positions + i * stride));
+            bounds.max = glm::max(bounds.max, glm::make_vec3(positions + i * stride));
+        }
+        // tighter than half the diagonal for most shapes
+        glm::vec3 center = bounds.center();
+        float radiusSq = 0.0f;
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 d = glm::make_vec3(positions + i * stride) - center;
+            radiusSq = glm::max(radiusSq, glm::dot(d, d));
+        }
+        bounds.radius = glm::sqrt(radiusSq);
+        return bounds;
+    }
+};
+
+// What a mesh keeps in system memory once its buffers are uploaded
+enum GeometryResidency {
+    RESIDENCY_DISCARD,          // nothing, the GPU copy is the only one
+    RESIDENCY_KEEP,             // vertices and indices as uploaded
+    RESIDENCY_KEEP_COMPRESSED   // quantised positions and indices, for picking and collision
+};
+
+// Positions quantised to 16 bits per axis within the mesh bounds, indices
+// in 16 bits when the mesh has few enough vertices
+struct CompressedGeometry {
+    std::vector<uint16_t>   positions;
+    std::vector<uint16_t>   indices16;
+    std::vector<uint32_t>   indices32;
+
+    size_t vertexCount() const { return positions.size() / 3; }
+    size_t indexCount() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+    unsigned int index(size_t i) const { return indices16.empty() ? indices32[i] : indices16[i]; }
+    glm::vec3 position(size_t i, const glm::vec3& boundsMin, const glm::vec3& boundsMax) const {
+        glm::vec3 q(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+        return boundsMin + q / 65535.0f * (boundsMax - boundsMin);
+    }
+    size_t bytes() const {
+        return positions.capacity() * sizeof(uint16_t) + indices16.capacity() * sizeof(uint16_t) +
+            indices32.capacity() * sizeof(uint32_t);
+    }
+};
+
+// Where a mesh lives in a vertex array and buffers it shares with other
+// meshes (see Model). Its indices start at firstIndex and are relative to
+// baseVertex.
+struct MeshRange {
+    unsigned int vao;
+    unsigned int firstIndex;
+    int baseVertex;
 };
 
 class Mesh
@@ -19,66 +82,143 @@ class Mesh
 public:
     std::vector<Vertex>         vertices;
     std::vector<unsigned int>   indices;
-    std::vector<TextureData>    textures;
+    unsigned int                material;   // index in the MaterialLibrary of the model
+    CompressedGeometry          compressed;
+    MeshBounds                  bounds;
 
-    Mesh(std::vector<Vertex> verts, std::vector<unsigned int> indcs, std::vector<TextureData> texts) :
-        vertices(verts),
-        indices(indcs),
-        textures(texts) 
+    Mesh(std::vector<Vertex> verts, std::vector<unsigned int> indcs, unsigned int material) :
+        vertices(std::move(verts)),
+        indices(std::move(indcs)),
+        material(material),
+        bounds(MeshBounds::of(vertices.data(), vertices.size())),
+        indexCount(indices.size()),
+        firstIndex(0),
+        baseVertex(0)
+    {
+        setup_mesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+    // Bounds already known, e.g. computed by the import workers
+    Mesh(std::vector<Vertex> verts, std::vector<unsigned int> indcs, unsigned int material,
+        const MeshBounds& bounds) :
+        vertices(std::move(verts)),
+        indices(std::move(indcs)),
+        material(material),
+        bounds(bounds),
+        indexCount(indices.size()),
+        firstIndex(0),
+        baseVertex(0)
     {
-        setup_mesh();
+        setup_mesh(vertices.data(), vertices.size(), indices.data(), indices.size());
+    }
+    // Part of buffers the owner filled and deletes. verts and indcs point
+    // at the same data in memory the mesh does not own (e.g. a mapped mesh
+    // cache), residency decides what is copied out of it.
+    Mesh(const MeshRange& range, const Vertex* verts, unsigned int vertexCount, const unsigned int* indcs, unsigned int indexCount,
+        unsigned int material, const MeshBounds& bounds,
+        GeometryResidency residency = RESIDENCY_DISCARD) :
+        material(material),
+        bounds(bounds),
+        VAO(range.vao), VBO(0), EBO(0),
+        indexCount(indexCount),
+        firstIndex(range.firstIndex),
+        baseVertex(range.baseVertex)
+    {
+        if (residency == RESIDENCY_KEEP) {
+            vertices.assign(verts, verts + vertexCount);
+            indices.assign(indcs, indcs + indexCount);
+        }
+        else if (residency == RESIDENCY_KEEP_COMPRESSED)
+            compress(verts, vertexCount, indcs, indexCount);
     }
 
-    void Draw(Shader& shader) {
-        unsigned int diffuseNr = 1;
-        unsigned int specularNr = 1;
-
-        for (int i = 0; i < textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            std::string number;
-            std::string name = textures[i].type;
-            if (name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            if (name == "texture_specular")
-                number = std::to_string(specularNr++);
-            shader.setInt(("material." + name + number).c_str(), i);
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    // Change what is held in system memory. Full geometry can only be
+    // compressed or dropped, it is not read back from the GPU.
+    void setResidency(GeometryResidency residency) {
+        if (residency == RESIDENCY_KEEP_COMPRESSED && !vertices.empty())
+            compress(vertices.data(), vertices.size(), indices.data(), indices.size());
+        if (residency != RESIDENCY_KEEP) {
+            std::vector<Vertex>().swap(vertices);
+            std::vector<unsigned int>().swap(indices);
         }
-        glActiveTexture(GL_TEXTURE0);   // unbind
+        if (residency == RESIDENCY_DISCARD)
+            compressed = CompressedGeometry();
+    }
+    // System memory held by this mesh: geometry and the mesh itself
+    size_t cpuBytes() const {
+        return sizeof(Mesh) + vertices.capacity() * sizeof(Vertex) +
+            indices.capacity() * sizeof(unsigned int) + compressed.bytes();
+    }
 
-        // Draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);           // unbind
+    // Geometry only, the owner binds the material first
+    void Draw() {
+        // Draw mesh, the VAO stays bound for the next draw
+        GLState::bindVertexArray(VAO);
+        glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void*)(firstIndex * sizeof(unsigned int)), baseVertex);
+    }
+    // count instances in one call, needs a program compiled with INSTANCED
+    // and the instance attributes attached to the VAO (InstanceBuffer),
+    // which is shared with the other meshes of the owner
+    void DrawInstanced(unsigned int count) {
+        GLState::bindVertexArray(VAO);
+        glDrawElementsInstancedBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+            (void*)(firstIndex * sizeof(unsigned int)), count, baseVertex);
+    }
+    unsigned int getIndexCount() const { return indexCount; }
+    unsigned int getFirstIndex() const { return firstIndex; }
+    int getBaseVertex() const { return baseVertex; }
+    // Point the attributes of the bound VAO at Vertex data in the bound
+    // GL_ARRAY_BUFFER, for owners of shared buffers
+    static void setup_attributes() {
+        // position
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        // normal
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(1);
+        // texcoords
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(2);
     }
 private:
-    unsigned int VAO, VBO, EBO;
-    void setup_mesh() {
+    unsigned int VAO, VBO, EBO;     // buffers are 0 when shared
+    unsigned int indexCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    void compress(const Vertex* verts, size_t vertexCount, const unsigned int* indcs, size_t indexCount) {
+        glm::vec3 extent = bounds.max - bounds.min;
+        glm::vec3 scale = glm::vec3(
+            extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+            extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+            extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+        compressed = CompressedGeometry();
+        compressed.positions.resize(vertexCount * 3);
+        for (size_t i = 0; i < vertexCount; i++) {
+            glm::vec3 q = glm::clamp((verts[i].Position - bounds.min) * scale, 0.0f, 65535.0f) + 0.5f;
+            compressed.positions[i * 3] = (uint16_t)q.x;
+            compressed.positions[i * 3 + 1] = (uint16_t)q.y;
+            compressed.positions[i * 3 + 2] = (uint16_t)q.z;
+        }
+        if (vertexCount <= 65536)
+            compressed.indices16.assign(indcs, indcs + indexCount);
+        else
+            compressed.indices32.assign(indcs, indcs + indexCount);
+    }
+    void setup_mesh(const Vertex* verts, unsigned int vertexCount, const unsigned int* indcs, unsigned int indexCount) {
         // Create buffers
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
         // Bind buffers
-        glBindVertexArray(VAO);
+        GLState::bindVertexArray(VAO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), verts, GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indcs, GL_STATIC_DRAW);
+        setup_attributes();
 
-        // Set attibutes
-        // position
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
-        // normal
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        glEnableVertexAttribArray(1);
-        // texcoords
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        glEnableVertexAttribArray(2);
-        
         // unbind
-        glBindVertexArray(0);
+        GLState::bindVertexArray(0);
     }
 };
 #endif
@@ -0,0 +1,314 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Binary copy of an imported model, written next to the source asset as
+// <asset>.meshcache. The file is laid out so it can be mapped and handed to
+// glBufferData as is:
+//
+//   Header | MeshRecord[meshCount] | MaterialRecord[materialCount] |
+//   TextureRecord[textureCount] | NodeRecord[nodeCount] | strings |
+//   per mesh: vertices, indices (16 byte aligned)
+//
+// The header stores the size and modification time of the source, a cache
+// for an edited asset (or an older format) is ignored and rewritten. Only
+// the main asset is stamped, touch it after editing its .mtl.
+namespace MeshCache
+{
+	const uint32_t MAGIC = 0x4D4C474F;	// "OGLM"
+	const uint32_t VERSION = 5;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		uint32_t meshCount;
+		uint32_t textureCount;
+		uint32_t vertexStride;
+		uint32_t nodeCount;
+		uint32_t materialCount;
+		uint32_t reserved;
+		uint64_t stringsOffset;
+		uint64_t stringsSize;
+	};
+
+	struct MeshRecord
+	{
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t material;
+		uint32_t reserved;
+		float boundsMin[3];
+		float boundsMax[3];
+		float boundsRadius;	// sphere around the centre of the box
+		uint32_t node;		// node the mesh is attached to
+	};
+
+	// Ns of the material and its maps
+	struct MaterialRecord
+	{
+		float shininess;
+		uint32_t firstTexture;	// range in the texture records
+		uint32_t textureCount;
+	};
+
+	// type ("texture_diffuse", ...) and path relative to the model directory
+	struct TextureRecord
+	{
+		uint32_t typeOffset;
+		uint32_t typeLength;
+		uint32_t pathOffset;
+		uint32_t pathLength;
+	};
+
+	// node hierarchy, parents before children
+	struct NodeRecord
+	{
+		int32_t parent;		// -1 for the root
+		float local[16];	// column major
+	};
+
+	inline std::string pathFor(const std::string& source) { return source + ".meshcache"; }
+
+	inline bool sourceStamp(const std::string& source, uint64_t& size, int64_t& time)
+	{
+		std::error_code error;
+		size = std::filesystem::file_size(source, error);
+		if (error)
+			return false;
+		time = std::filesystem::last_write_time(source, error).time_since_epoch().count();
+		return !error;
+	}
+
+	class Reader
+	{
+	public:
+		// Maps the cache of source, fails if it is missing, stale or corrupt
+		bool open(const std::string& source, uint32_t vertexStride)
+		{
+			if (!file.open(pathFor(source)))
+				return false;
+			uint64_t size;
+			int64_t time;
+			if (!sourceStamp(source, size, time) || !validate(size, time, vertexStride)) {
+				file.close();
+				return false;
+			}
+			return true;
+		}
+		void close() { file.close(); }
+
+		unsigned int meshCount() const { return header().meshCount; }
+		const MeshRecord& mesh(unsigned int i) const { return ((const MeshRecord*)(file.data() + sizeof(Header)))[i]; }
+		const void* vertices(unsigned int i) const { return file.data() + mesh(i).vertexOffset; }
+		const uint32_t* indices(unsigned int i) const { return (const uint32_t*)(file.data() + mesh(i).indexOffset); }
+
+		unsigned int materialCount() const { return header().materialCount; }
+		const MaterialRecord& material(unsigned int i) const
+		{
+			return ((const MaterialRecord*)(file.data() + sizeof(Header) + header().meshCount * sizeof(MeshRecord)))[i];
+		}
+		unsigned int nodeCount() const { return header().nodeCount; }
+		const NodeRecord& node(unsigned int i) const
+		{
+			const Header& h = header();
+			return ((const NodeRecord*)(file.data() + sizeof(Header) + h.meshCount * sizeof(MeshRecord) +
+				h.materialCount * sizeof(MaterialRecord) + h.textureCount * sizeof(TextureRecord)))[i];
+		}
+
+		std::string textureType(unsigned int i) const { return string(texture(i).typeOffset, texture(i).typeLength); }
+		std::string texturePath(unsigned int i) const { return string(texture(i).pathOffset, texture(i).pathLength); }
+
+	private:
+		MappedFile file;
+
+		const Header& header() const { return *(const Header*)file.data(); }
+		const TextureRecord& texture(unsigned int i) const
+		{
+			return ((const TextureRecord*)(file.data() + sizeof(Header) + header().meshCount * sizeof(MeshRecord) +
+				header().materialCount * sizeof(MaterialRecord)))[i];
+		}
+		std::string string(uint32_t offset, uint32_t length) const
+		{
+			return std::string((const char*)file.data() + header().stringsOffset + offset, length);
+		}
+
+		// Everything is range checked once so the accessors can trust it
+		bool validate(uint64_t sourceSize, int64_t sourceTime, uint32_t vertexStride) const
+		{
+			size_t size = file.size();
+			if (size < sizeof(Header))
+				return false;
+			const Header& h = header();
+			if (h.magic != MAGIC || h.version != VERSION || h.vertexStride != vertexStride ||
+				h.sourceSize != sourceSize || h.sourceTime != sourceTime)
+				return false;
+			uint64_t tables = sizeof(Header) + (uint64_t)h.meshCount * sizeof(MeshRecord) + (uint64_t)h.materialCount * sizeof(MaterialRecord) +
+				(uint64_t)h.textureCount * sizeof(TextureRecord) + (uint64_t)h.nodeCount * sizeof(NodeRecord);
+			if (tables > size || h.stringsOffset < tables || h.stringsOffset + h.stringsSize > size)
+				return false;
+			for (unsigned int i = 0; i < h.meshCount; i++) {
+				const MeshRecord& m = mesh(i);
+				if (m.vertexOffset + (uint64_t)m.vertexCount * vertexStride > size || m.vertexOffset % 4 ||
+					m.indexOffset + (uint64_t)m.indexCount * sizeof(uint32_t) > size || m.indexOffset % 4 ||
+					m.material >= h.materialCount || m.node >= h.nodeCount)
+					return false;
+			}
+			for (unsigned int i = 0; i < h.materialCount; i++) {
+				if ((uint64_t)material(i).firstTexture + material(i).textureCount > h.textureCount)
+					return false;
+			}
+			for (unsigned int i = 0; i < h.nodeCount; i++) {
+				if (node(i).parent >= (int32_t)i || node(i).parent < -1)
+					return false;
+			}
+			for (unsigned int i = 0; i < h.textureCount; i++) {
+				const TextureRecord& t = texture(i);
+				if ((uint64_t)t.typeOffset + t.typeLength > h.stringsSize || (uint64_t)t.pathOffset + t.pathLength > h.stringsSize)
+					return false;
+			}
+			return true;
+		}
+	};
+
+	// Collects meshes and writes them in one go. Only pointers to the vertex
+	// and index data are kept, they have to stay valid until write().
+	class Writer
+	{
+	public:
+		void addMesh(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+			uint32_t material, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float boundsRadius, uint32_t node)
+		{
+			MeshRecord record = {};
+			record.vertexCount = vertexCount;
+			record.indexCount = indexCount;
+			record.material = material;
+			for (int k = 0; k < 3; k++) {
+				record.boundsMin[k] = boundsMin[k];
+				record.boundsMax[k] = boundsMax[k];
+			}
+			record.boundsRadius = boundsRadius;
+			record.node = node;
+			meshes.push_back(record);
+			data.push_back(std::make_pair(vertices, indices));
+		}
+
+		void addMaterial(float shininess, const std::vector<std::string>& textureTypes, const std::vector<std::string>& texturePaths)
+		{
+			MaterialRecord record = {};
+			record.shininess = shininess;
+			record.firstTexture = textures.size();
+			record.textureCount = textureTypes.size();
+			for (unsigned int i = 0; i < textureTypes.size(); i++) {
+				TextureRecord texture;
+				texture.typeOffset = addString(textureTypes[i]);
+				texture.typeLength = textureTypes[i].size();
+				texture.pathOffset = addString(texturePaths[i]);
+				texture.pathLength = texturePaths[i].size();
+				textures.push_back(texture);
+			}
+			materials.push_back(record);
+		}
+
+		void addNode(int32_t parent, const glm::mat4& local)
+		{
+			NodeRecord record;
+			record.parent = parent;
+			for (int k = 0; k < 16; k++)
+				record.local[k] = local[k / 4][k % 4];
+			nodes.push_back(record);
+		}
+
+		bool write(const std::string& source, uint32_t vertexStride)
+		{
+			Header header = {};
+			header.magic = MAGIC;
+			header.version = VERSION;
+			if (!sourceStamp(source, header.sourceSize, header.sourceTime))
+				return false;
+			header.meshCount = meshes.size();
+			header.textureCount = textures.size();
+			header.vertexStride = vertexStride;
+			header.nodeCount = nodes.size();
+			header.materialCount = materials.size();
+			header.stringsOffset = sizeof(Header) + meshes.size() * sizeof(MeshRecord) + materials.size() * sizeof(MaterialRecord) +
+				textures.size() * sizeof(TextureRecord) + nodes.size() * sizeof(NodeRecord);
+			header.stringsSize = strings.size();
+			uint64_t offset = align(header.stringsOffset + header.stringsSize);
+			for (unsigned int i = 0; i < meshes.size(); i++) {
+				meshes[i].vertexOffset = offset;
+				offset = align(offset + (uint64_t)meshes[i].vertexCount * vertexStride);
+				meshes[i].indexOffset = offset;
+				offset = align(offset + (uint64_t)meshes[i].indexCount * sizeof(uint32_t));
+			}
+
+			// write to a temporary name first so readers never see half a file
+			std::string target = pathFor(source);
+			std::string temp = target + ".tmp";
+			{
+				std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+				file.write((const char*)&header, sizeof(header));
+				file.write((const char*)meshes.data(), meshes.size() * sizeof(MeshRecord));
+				file.write((const char*)materials.data(), materials.size() * sizeof(MaterialRecord));
+				file.write((const char*)textures.data(), textures.size() * sizeof(TextureRecord));
+				file.write((const char*)nodes.data(), nodes.size() * sizeof(NodeRecord));
+				file.write(strings.data(), strings.size());
+				uint64_t written = header.stringsOffset + header.stringsSize;
+				for (unsigned int i = 0; i < meshes.size(); i++) {
+					written = pad(file, written, meshes[i].vertexOffset);
+					file.write((const char*)data[i].first, (uint64_t)meshes[i].vertexCount * vertexStride);
+					written += (uint64_t)meshes[i].vertexCount * vertexStride;
+					written = pad(file, written, meshes[i].indexOffset);
+					file.write((const char*)data[i].second, (uint64_t)meshes[i].indexCount * sizeof(uint32_t));
+					written += (uint64_t)meshes[i].indexCount * sizeof(uint32_t);
+				}
+				if (!file) {
+					std::cout << "WARNING::MESH_CACHE::Failed to write " << temp << std::endl;
+					return false;
+				}
+			}
+			std::error_code error;
+			std::filesystem::rename(temp, target, error);
+			return !error;
+		}
+
+	private:
+		std::vector<MeshRecord> meshes;
+		std::vector<MaterialRecord> materials;
+		std::vector<TextureRecord> textures;
+		std::vector<NodeRecord> nodes;
+		std::vector<char> strings;
+		std::vector<std::pair<const void*, const uint32_t*>> data;
+
+		uint32_t addString(const std::string& value)
+		{
+			uint32_t offset = strings.size();
+			strings.insert(strings.end(), value.begin(), value.end());
+			return offset;
+		}
+		static uint64_t align(uint64_t offset) { return (offset + 15) & ~(uint64_t)15; }
+		static uint64_t pad(std::ofstream& file, uint64_t written, uint64_t offset)
+		{
+			static const char zeros[16] = {};
+			file.write(zeros, offset - written);
+			return offset;
+		}
+	};
+}
+
+#endif // !MESH_CACHE_H
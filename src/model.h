@@ -5,21 +5,339 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <algorithm>
+
+#include "culling.h"
+#include "glext.h"
+#include "gpu_culling.h"
+#include "indirect_draw.h"
+#include "instances.h"
+#include "material.h"
+#include "mesh_cache.h"
+#include "scene_graph.h"
+#include "thread_pool.h"
+#include "transforms.h"
+
 class Model
 {
 public:
-	Model(const char* path) {
+	// residency decides what geometry stays in system memory after upload
+	Model(const char* path, GeometryResidency residency = RESIDENCY_DISCARD) :
+		residency(residency), packedVAO(0), packedVBO(0), packedEBO(0), instanceBuffer(0), commandBuffer(0), drawBuffer(0),
+		commandCapacity(0) {
+		// warm loads skip Assimp entirely
+		if (loadCache(path))
+			return;
 		loadModel(path);
 	}
-	void Draw(Shader &shader){
+	// Every mesh with its material and model * node transform
+	void Draw(Shader &shader, const glm::mat4& model = glm::mat4(1.0f)){
+		nodeTransforms.clear();
+		addTransforms(nodeTransforms, model);
+		nodeTransforms.update();
+		const MaterialLibrary::Bindings& bindings = materials.bindings(shader);
+		int applied = -1, bound = -1;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			// meshes of one node share their matrices
+			if (applied < 0 || meshNodes[applied] != meshNodes[i])
+				nodeTransforms.apply(shader, i);
+			applied = i;
+			if ((int)meshes[i].material != bound)
+				materials.bind(shader, bindings, meshes[i].material);
+			bound = meshes[i].material;
+			meshes[i].Draw();
+		}
+	}
+	// Single mesh with its material, for callers that order draws themselves
+	void DrawMesh(Shader &shader, unsigned int i){
+		materials.bind(shader, materials.bindings(shader), meshes[i].material);
+		meshes[i].Draw();
+	}
+	unsigned int meshCount() const { return meshes.size(); }
+	unsigned int materialOf(unsigned int i) const { return meshes[i].material; }
+	// Every instance of the model in one draw call per mesh, the instance
+	// transforms are applied on top of the node transforms. shader is built
+	// with INSTANCED and in use, instances has to be uploaded.
+	void DrawInstanced(Shader &shader, const InstanceBuffer& instances){
+		if (instances.size() == 0)
+			return;
+		GLState::bindVertexArray(packedVAO);
+		// the attributes of the shared vertex array stay pointed at the
+		// last buffer attached
+		if (instanceBuffer != instances.id) {
+			instances.attach();
+			instanceBuffer = instances.id;
+		}
+		nodeTransforms.clear();
+		addTransforms(nodeTransforms, glm::mat4(1.0f));
+		nodeTransforms.update();
+		const MaterialLibrary::Bindings& b = materials.bindings(shader);
+		int bound = -1;
+		for (unsigned int k = 0; k < drawOrder.size(); k++) {
+			unsigned int i = drawOrder[k];
+			if ((int)meshes[i].material != bound) {
+				materials.bind(shader, b, meshes[i].material);
+				bound = meshes[i].material;
+			}
+			// skipped by the shadow copies for meshes of one node
+			nodeTransforms.apply(shader, i);
+			meshes[i].DrawInstanced(instances.size());
+		}
+	}
+	// Bounds around every mesh in the space of the model, with the node
+	// transforms as of the last update
+	MeshBounds bounds() const {
+		MeshBounds result;
 		for (unsigned int i = 0; i < meshes.size(); i++) {
-			meshes[i].Draw(shader);
+			const MeshBounds& b = meshes[i].bounds;
+			const glm::mat4& node = graph.world(meshNodes[i]);
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 p = glm::vec3(corner & 1 ? b.max.x : b.min.x, corner & 2 ? b.max.y : b.min.y, corner & 4 ? b.max.z : b.min.z);
+				p = glm::vec3(node * glm::vec4(p, 1.0f));
+				result.min = i == 0 && corner == 0 ? p : glm::min(result.min, p);
+				result.max = i == 0 && corner == 0 ? p : glm::max(result.max, p);
+			}
 		}
+		result.radius = glm::length(result.max - result.min) * 0.5f;
+		return result;
+	}
+	// Node hierarchy of the asset, move nodes with setLocal()
+	SceneGraph& nodes() { return graph; }
+	// Add model * node transform of every mesh to transforms, after updating
+	// the nodes that moved. Returns the index of the first.
+	unsigned int addTransforms(TransformBatch& transforms, const glm::mat4& model) {
+		graph.update();
+		unsigned int first = transforms.size();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			transforms.add(model * graph.world(meshNodes[i]));
+		return first;
+	}
+	// Add the bounds of every mesh to culler, returns the index of the first
+	unsigned int addBounds(FrustumCuller& culler, const TransformBatch& transforms, unsigned int firstTransform) const {
+		unsigned int first = culler.size();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			culler.add(meshes[i].bounds, transforms.model(firstTransform + i));
+		return first;
+	}
+	// Visible meshes of one material in the packed draws, distance is from
+	// the eye to the center of the nearest one
+	struct PackedRun {
+		unsigned int material;
+		unsigned int first, count;
+		float distance;
+	};
+	// Pack the meshes culler left visible into indirect draws, a run per
+	// material since textures cannot change within a multi draw, and upload
+	// them. Needs GLExt.multiDrawIndirect. Returns the number of runs.
+	unsigned int packVisible(const TransformBatch& transforms, unsigned int firstTransform,
+		const FrustumCuller& culler, unsigned int firstBounds, const glm::vec3& eye){
+		commands.clear();
+		draws.clear();
+		runs.clear();
+		for (unsigned int k = 0; k < drawOrder.size(); k++) {
+			unsigned int i = drawOrder[k];
+			if (!culler.visible(firstBounds + i))
+				continue;
+			float distance = glm::length(culler.center(firstBounds + i) - eye);
+			if (runs.empty() || runs.back().material != meshes[i].material) {
+				PackedRun run = { meshes[i].material, (unsigned int)commands.size(), 0, distance };
+				runs.push_back(run);
+			}
+			runs.back().count++;
+			runs.back().distance = std::min(runs.back().distance, distance);
+			commands.push_back(commandOf(i));
+			draws.push_back(drawDataOf(i, transforms, firstTransform));
+		}
+		if (!commands.empty())
+			uploadDraws();
+		return runs.size();
+	}
+	const PackedRun& packedRun(unsigned int run) const { return runs[run]; }
+	// One run of packVisible() in a single glMultiDrawElementsIndirect.
+	// Model and normal matrices go to a storage buffer read with gl_DrawID,
+	// shader is built from indirect.vert.
+	void DrawPackedRun(Shader &shader, unsigned int run){
+		const PackedRun& r = runs[run];
+		GLState::bindVertexArray(packedVAO);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawBuffer);
+		materials.bind(shader, materials.bindings(shader), r.material);
+		shader.setInt(indirectBindings.get(shader).drawOffset, r.first);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(r.first * sizeof(DrawCommand)), r.count, 0);
+	}
+	// Distance from eye to the center of the nearest mesh with material,
+	// for ordering draws whose visibility is only known on the GPU
+	float materialDistance(unsigned int material, const TransformBatch& transforms, unsigned int firstTransform,
+		const glm::vec3& eye) const {
+		float distance = -1.0f;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			if (meshes[i].material != material)
+				continue;
+			glm::vec3 center = glm::vec3(transforms.model(firstTransform + i) * glm::vec4(meshes[i].bounds.center(), 1.0f));
+			float d = glm::length(center - eye);
+			distance = distance < 0.0f ? d : std::min(distance, d);
+		}
+		return std::max(distance, 0.0f);
+	}
+	// Hand every mesh to culler with its transform, in buckets by material.
+	// Again after the transforms changed.
+	void addDraws(GPUCuller& culler, const TransformBatch& transforms, unsigned int firstTransform) const {
+		for (unsigned int k = 0; k < drawOrder.size(); k++) {
+			unsigned int i = drawOrder[k];
+			culler.add(commandOf(i), drawDataOf(i, transforms, firstTransform), meshes[i].bounds, meshes[i].material);
+		}
+	}
+	// What culler left of the draws from addDraws() in one bucket, a multi
+	// draw of the material that is the bucket's key. shader is built from
+	// indirect.vert.
+	void DrawCulled(Shader &shader, const GPUCuller& culler, unsigned int bucket){
+		GLState::bindVertexArray(packedVAO);
+		materials.bind(shader, materials.bindings(shader), culler.bucketKey(bucket));
+		culler.draw(shader, bucket);
+	}
+	void setResidency(GeometryResidency residency) {
+		this->residency = residency;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			meshes[i].setResidency(residency);
+	}
+	GeometryResidency getResidency() const { return residency; }
+	MaterialLibrary& getMaterials() { return materials; }
+	// System memory held by the model after loading
+	size_t cpuBytes() const {
+		size_t bytes = sizeof(Model) + meshes.capacity() * sizeof(Mesh) - meshes.size() * sizeof(Mesh) +
+			directory.capacity() + (meshNodes.capacity() + drawOrder.capacity()) * sizeof(unsigned int) +
+			commands.capacity() * sizeof(DrawCommand) + draws.capacity() * sizeof(DrawData) +
+			graph.size() * (sizeof(int) + 2 * sizeof(glm::mat4) + 1) + materials.cpuBytes();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			bytes += meshes[i].cpuBytes();
+		return bytes;
+	}
+	// Shared buffers of the meshes and the multi draw buffers
+	void Delete() {
+		if (packedVAO)
+			GLState::deleteVertexArray(packedVAO);
+		glDeleteBuffers(1, &packedVBO);
+		glDeleteBuffers(1, &packedEBO);
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteBuffers(1, &drawBuffer);
+		packedVAO = packedVBO = packedEBO = instanceBuffer = commandBuffer = drawBuffer = 0;
+		commandCapacity = 0;
 	}
 private:
+
 	std::vector<Mesh> meshes;
+	std::vector<unsigned int> meshNodes;	// graph node of each mesh
+	SceneGraph graph;
+	// model * node transforms of the meshes for Draw()
+	TransformBatch nodeTransforms;
+	MaterialLibrary materials;
+	GeometryResidency residency;
 	std::string directory;
-	std::vector<TextureData> textures_loaded;
+	// Every mesh lives in these, indices relative to the first vertex of
+	// their mesh
+	unsigned int packedVAO, packedVBO, packedEBO;
+	unsigned int instanceBuffer;	// attached to packedVAO, 0 for none
+	// meshes by material then import order, the order of the multi draws
+	std::vector<unsigned int> drawOrder;
+	std::vector<DrawCommand> commands;
+	std::vector<DrawData> draws;
+	std::vector<PackedRun> runs;
+	unsigned int commandBuffer, drawBuffer;
+	size_t commandCapacity;	// in draws, of both buffers
+	// Handle of the first draw of a multi draw in indirect.vert
+	struct IndirectBindings {
+		int drawOffset;
+
+		void resolve(const Shader& shader) {
+			drawOffset = shader.uniform("drawOffset");
+		}
+	};
+	UniformBindings<IndirectBindings> indirectBindings;
+
+	// Output of the CPU stage of the import for one aiMesh, the vertices and
+	// indices live in the import arena
+	struct MeshData {
+		size_t firstVertex, vertexCount;
+		size_t firstIndex, indexCount;
+		MeshBounds bounds;
+		unsigned int node;
+		unsigned int material;
+	};
+	// Material values and texture paths, the textures are loaded in the GL
+	// stage and written to the mesh cache as is
+	struct MaterialData {
+		float shininess = 32.0f;
+		std::vector<std::string> textureTypes;
+		std::vector<std::string> texturePaths;
+	};
+	// One allocation each for the vertices and indices of a whole import.
+	// Sizes are known from the aiMesh headers up front, so the workers write
+	// every vertex exactly once into their own range. Left uninitialised.
+	struct ImportArena {
+		std::unique_ptr<Vertex[]> vertices;
+		std::unique_ptr<unsigned int[]> indices;
+	};
+
+	bool loadCache(const std::string& path) {
+		MeshCache::Reader cache;
+		if (!cache.open(path, sizeof(Vertex)))
+			return false;
+		directory = path.substr(0, path.find_last_of("/"));
+		for (unsigned int i = 0; i < cache.nodeCount(); i++)
+			graph.addNode(cache.node(i).parent, glm::make_mat4(cache.node(i).local));
+		for (unsigned int i = 0; i < cache.materialCount(); i++) {
+			const MeshCache::MaterialRecord& record = cache.material(i);
+			MaterialData material;
+			material.shininess = record.shininess;
+			for (unsigned int j = record.firstTexture; j < record.firstTexture + record.textureCount; j++) {
+				material.textureTypes.push_back(cache.textureType(j));
+				material.texturePaths.push_back(cache.texturePath(j));
+			}
+			materials.add(loadMaterial(material));
+		}
+		size_t vertexCount = 0, indexCount = 0;
+		for (unsigned int i = 0; i < cache.meshCount(); i++) {
+			vertexCount += cache.mesh(i).vertexCount;
+			indexCount += cache.mesh(i).indexCount;
+		}
+		createPackedBuffers(NULL, vertexCount, NULL, indexCount);
+		meshes.reserve(cache.meshCount());
+		meshNodes.reserve(cache.meshCount());
+		MeshRange range = { packedVAO, 0, 0 };
+		for (unsigned int i = 0; i < cache.meshCount(); i++) {
+			const MeshCache::MeshRecord& record = cache.mesh(i);
+			MeshBounds bounds;
+			bounds.min = glm::make_vec3(record.boundsMin);
+			bounds.max = glm::make_vec3(record.boundsMax);
+			bounds.radius = record.boundsRadius;
+			// vertices go from the mapping to the driver without a copy
+			glBufferSubData(GL_ARRAY_BUFFER, range.baseVertex * sizeof(Vertex), record.vertexCount * sizeof(Vertex), cache.vertices(i));
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, range.firstIndex * sizeof(unsigned int), record.indexCount * sizeof(unsigned int), cache.indices(i));
+			meshes.emplace_back(range, (const Vertex*)cache.vertices(i), record.vertexCount, cache.indices(i), record.indexCount,
+				record.material, bounds, residency);
+			meshNodes.push_back(record.node);
+			range.firstIndex += record.indexCount;
+			range.baseVertex += record.vertexCount;
+		}
+		GLState::bindVertexArray(0);
+		sortDrawOrder();
+		return true;
+	}
+	void writeCache(const std::string& path, const ImportArena& arena, const std::vector<MeshData>& data,
+		const std::vector<MaterialData>& materialData) {
+		if (data.empty())
+			return;
+		MeshCache::Writer cache;
+		for (unsigned int i = 0; i < graph.size(); i++)
+			cache.addNode(graph.parent(i), graph.local(i));
+		for (unsigned int i = 0; i < materialData.size(); i++)
+			cache.addMaterial(materialData[i].shininess, materialData[i].textureTypes, materialData[i].texturePaths);
+		for (unsigned int i = 0; i < data.size(); i++)
+			cache.addMesh(arena.vertices.get() + data[i].firstVertex, data[i].vertexCount,
+				arena.indices.get() + data[i].firstIndex, data[i].indexCount,
+				data[i].material, data[i].bounds.min, data[i].bounds.max, data[i].bounds.radius, data[i].node);
+		cache.write(path, sizeof(Vertex));
+	}
 
 	void loadModel(std::string path){
 		// assimp load scene
@@ -33,93 +351,194 @@ private:
 		}
 		// set directory
 		directory = path.substr(0, path.find_last_of("/"));
-		// process sub nodes
-		processNode(scene->mRootNode, scene);
+		// CPU stage: size the arena, then convert all meshes on the worker
+		// threads. The scene is only read from here on.
+		std::vector<const aiMesh*> sceneMeshes;
+		std::vector<unsigned int> sceneNodes;
+		processNode(scene->mRootNode, SceneGraph::NO_PARENT, scene, sceneMeshes, sceneNodes);
+		std::vector<MeshData> data(sceneMeshes.size());
+		// materials the meshes use, numbered in order of first use
+		std::vector<MaterialData> materialData;
+		std::vector<int> materialIds(scene->mNumMaterials, -1);
+		size_t vertexCount = 0, indexCount = 0;
+		for (unsigned int i = 0; i < sceneMeshes.size(); i++) {
+			data[i].firstVertex = vertexCount;
+			data[i].vertexCount = sceneMeshes[i]->mNumVertices;
+			data[i].firstIndex = indexCount;
+			data[i].indexCount = countIndices(sceneMeshes[i]);
+			data[i].node = sceneNodes[i];
+			unsigned int materialIndex = sceneMeshes[i]->mMaterialIndex;
+			if (materialIds[materialIndex] < 0) {
+				materialIds[materialIndex] = materialData.size();
+				materialData.push_back(processMaterial(scene->mMaterials[materialIndex]));
+			}
+			data[i].material = materialIds[materialIndex];
+			vertexCount += data[i].vertexCount;
+			indexCount += data[i].indexCount;
+		}
+		ImportArena arena;
+		arena.vertices.reset(new Vertex[vertexCount]);
+		arena.indices.reset(new unsigned int[indexCount]);
+		ThreadPool::shared().parallelFor(sceneMeshes.size(), [&](unsigned int i) {
+			processMesh(sceneMeshes[i], arena.vertices.get() + data[i].firstVertex,
+				arena.indices.get() + data[i].firstIndex, data[i]);
+		});
+		writeCache(path, arena, data, materialData);
+		// GL stage: textures and buffers on the context thread, in node
+		// order. The arena is uploaded as is in one buffer each.
+		for (unsigned int i = 0; i < materialData.size(); i++)
+			materials.add(loadMaterial(materialData[i]));
+		createPackedBuffers(arena.vertices.get(), vertexCount, arena.indices.get(), indexCount);
+		GLState::bindVertexArray(0);
+		meshes.reserve(meshes.size() + data.size());
+		meshNodes.reserve(meshNodes.size() + data.size());
+		for (unsigned int i = 0; i < data.size(); i++) {
+			MeshRange range = { packedVAO, (unsigned int)data[i].firstIndex, (int)data[i].firstVertex };
+			meshes.emplace_back(range, arena.vertices.get() + data[i].firstVertex, data[i].vertexCount,
+				arena.indices.get() + data[i].firstIndex, data[i].indexCount,
+				data[i].material, data[i].bounds, residency);
+			meshNodes.push_back(data[i].node);
+		}
+		sortDrawOrder();
+	}
+	// One VAO over one vertex and one index buffer for all meshes, left
+	// bound with its buffers. NULL data only allocates.
+	void createPackedBuffers(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+		glGenVertexArrays(1, &packedVAO);
+		glGenBuffers(1, &packedVBO);
+		glGenBuffers(1, &packedEBO);
+		GLState::bindVertexArray(packedVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, packedVBO);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, packedEBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+		Mesh::setup_attributes();
+	}
+	DrawCommand commandOf(unsigned int i) const {
+		DrawCommand command;
+		command.count = meshes[i].getIndexCount();
+		command.instanceCount = 1;
+		command.firstIndex = meshes[i].getFirstIndex();
+		command.baseVertex = meshes[i].getBaseVertex();
+		command.baseInstance = 0;
+		return command;
 	}
-	void processNode(aiNode* node, const aiScene* scene){
+	DrawData drawDataOf(unsigned int i, const TransformBatch& transforms, unsigned int firstTransform) const {
+		DrawData draw;
+		draw.model = transforms.model(firstTransform + i);
+		const glm::mat3& normal = transforms.normal(firstTransform + i);
+		for (int c = 0; c < 3; c++)
+			draw.normalMatrix[c] = glm::vec4(normal[c], 0.0f);
+		draw.material = meshes[i].material;
+		return draw;
+	}
+	void sortDrawOrder() {
+		drawOrder.resize(meshes.size());
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			drawOrder[i] = i;
+		std::stable_sort(drawOrder.begin(), drawOrder.end(), [this](unsigned int a, unsigned int b) {
+			return meshes[a].material < meshes[b].material;
+		});
+	}
+	// Commands and per draw data of the frame, orphaned like InstanceBuffer
+	void uploadDraws() {
+		if (!commandBuffer) {
+			glGenBuffers(1, &commandBuffer);
+			glGenBuffers(1, &drawBuffer);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+		if (commands.size() > commandCapacity) {
+			commandCapacity = commands.size();
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, commandCapacity * sizeof(DrawData), draws.data(), GL_STREAM_DRAW);
+		} else {
+			glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(DrawCommand), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+			glBufferData(GL_SHADER_STORAGE_BUFFER, commandCapacity * sizeof(DrawData), NULL, GL_STREAM_DRAW);
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, draws.size() * sizeof(DrawData), draws.data());
+		}
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawBuffer);
+	}
+	// Add the node tree to the graph, depth first so parents come first, and
+	// collect its meshes in draw order together with their nodes
+	void processNode(const aiNode* node, int parent, const aiScene* scene,
+		std::vector<const aiMesh*>& sceneMeshes, std::vector<unsigned int>& sceneNodes){
+		// aiMatrix4x4 is row major
+		const aiMatrix4x4& m = node->mTransformation;
+		glm::mat4 local = glm::transpose(glm::make_mat4(&m.a1));
+		unsigned int index = graph.addNode(parent, local);
 		// process meshes
 		for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
+			sceneNodes.push_back(index);
 		}
 		// process sub nodes
 		for (unsigned int i = 0; i < node->mNumChildren; i++) {
-			processNode(node->mChildren[i], scene);
+			processNode(node->mChildren[i], index, scene, sceneMeshes, sceneNodes);
 		}
 	}
+	static size_t countIndices(const aiMesh* mesh) {
+		// aiProcess_Triangulate leaves only triangles, unless there are
+		// points or lines
+		if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+			return (size_t)mesh->mNumFaces * 3;
+		size_t count = 0;
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+			count += mesh->mFaces[i].mNumIndices;
+		return count;
+	}
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene){
-		std::vector<Vertex> vertices;
-		std::vector<unsigned int> indices;
-		std::vector<TextureData> textures;
-
+	// Runs on a worker thread, must not touch GL or the model
+	static void processMesh(const aiMesh* mesh, Vertex* vertices, unsigned int* indices, MeshData& data){
 		// process vertices
+		const aiVector3D* texCoords = mesh->mTextureCoords[0];
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-			Vertex vertex;
-			glm::vec3 vector;
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.Position = vector;
-			vector.x = mesh->mNormals[i].x;
-			vector.y = mesh->mNormals[i].y;
-			vector.z = mesh->mNormals[i].z;
-			vertex.Normal = vector;
-			if (mesh->mTextureCoords[0]) {
-				glm::vec2 vector;
-				vector.x = mesh->mTextureCoords[0][i].x;
-				vector.y = mesh->mTextureCoords[0][i].y;
-				vertex.TexCoords = vector;
-			}
-			else
-				vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-			vertices.push_back(vertex);
+			Vertex& vertex = vertices[i];
+			vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+			vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+			vertex.TexCoords = texCoords ? glm::vec2(texCoords[i].x, texCoords[i].y) : glm::vec2(0.0f, 0.0f);
 		}
+		// bounds
+		data.bounds = MeshBounds::of(vertices, mesh->mNumVertices);
 		// process indices
 		for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-			aiFace face = mesh->mFaces[i];
+			const aiFace& face = mesh->mFaces[i];
 			for (unsigned int j = 0; j < face.mNumIndices; j++) {
-				indices.push_back(face.mIndices[j]);
+				*indices++ = face.mIndices[j];
 			}
 		}
-		// process textures
-		if (mesh->mMaterialIndex >= 0) {
-			aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
-			std::vector<TextureData> diffuseMaps 
-				= loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-			textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-			std::vector<TextureData> specularMaps 
-				= loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-			textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-		}
-		return Mesh(vertices, indices, textures);
 	}
-	std::vector<TextureData> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName) {
-		std::vector<TextureData> textures;
+	// Ns and the texture paths of an MTL material
+	static MaterialData processMaterial(const aiMaterial* mat) {
+		MaterialData data;
+		float shininess;
+		if (mat->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS && shininess > 0.0f)
+			data.shininess = shininess;
+		// resolve texture paths, the textures are loaded in the GL stage
+		materialTextures(mat, aiTextureType_DIFFUSE, "texture_diffuse", data);
+		materialTextures(mat, aiTextureType_SPECULAR, "texture_specular", data);
+		return data;
+	}
+	static void materialTextures(const aiMaterial* mat, aiTextureType type, const std::string& typeName, MaterialData& data) {
 		for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true;
-					break;
-				}
-			}
-			if (!skip) {
-				TextureData texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture);
-			}
+			data.textureTypes.push_back(typeName);
+			data.texturePaths.push_back(str.C_Str());
+		}
+	}
+	// Textures are shared through the TextureCache with every other model,
+	// the first texture of each map is used
+	Material loadMaterial(const MaterialData& data) {
+		Material material;
+		material.shininess = data.shininess;
+		for (unsigned int i = 0; i < data.textureTypes.size(); i++) {
+			MaterialMap map = Material::mapOf(data.textureTypes[i]);
+			if (map != MATERIAL_MAP_COUNT && !material.maps[map])
+				material.maps[map] = TextureFromFile(data.texturePaths[i].c_str(), this->directory);
 		}
-		return textures;
+		return material;
 	}
 };
 
@@ -0,0 +1,132 @@
+#ifndef OIT_H
+#define OIT_H
+
+#include <glad/glad.h>
+
+#include "glext.h"
+#include "gl_state.h"
+#include "shader.h"
+
+// How transparent objects are drawn
+enum TransparencyMode {
+	TRANSPARENCY_SORTED,	// far to near with alpha blending (simple.frag)
+	TRANSPARENCY_WEIGHTED	// weighted blended OIT, no sorting (oit.frag)
+};
+
+// Weighted blended order-independent transparency for one view. Between
+// begin() and composite() transparent objects are drawn in any order into
+// two targets: the weighted sum of premultiplied colours and the product
+// of (1 - alpha). composite() resolves them over the opaque image. Depth is
+// copied from the view so opaque objects still hide transparent ones.
+//
+// Needs a blend function per draw buffer (GL 4.0), check supported().
+class WeightedOIT
+{
+public:
+	WeightedOIT() : fbo(0), accum(0), revealage(0), depth(0), vao(0), width(0), height(0) {}
+
+	static bool supported() { return GLExt.drawBuffersBlend; }
+
+	// Draw the transparent objects of target (width x height, with a
+	// DEPTH24_STENCIL8 depth buffer) after this, with depth writes off.
+	// The depth and blend state is saved for composite().
+	void begin(unsigned int target, unsigned int width, unsigned int height)
+	{
+		saved = GLState::depthBlendState();
+		if (width != this->width || height != this->height)
+			allocate(width, height);
+		// depth and stencil of the opaque pass
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+		glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		const float zeros[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		const float ones[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		glClearBufferfv(GL_COLOR, 0, zeros);
+		glClearBufferfv(GL_COLOR, 1, ones);
+		GLState::enable(GL_DEPTH_TEST, true);
+		GLState::depthMask(false);
+		GLState::enable(GL_BLEND, true);
+		GLState::blendFunci(0, GL_ONE, GL_ONE);
+		GLState::blendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+	}
+
+	// Blend the result over target and restore the depth and blend state
+	// of begin(). shader is the oit_composite program.
+	void composite(unsigned int target, Shader& shader)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, target);
+		GLState::enable(GL_DEPTH_TEST, false);
+		GLState::blendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+		shader.use();
+		shader.setInt("accumTexture", 0);
+		shader.setInt("revealageTexture", 1);
+		GLState::bindTexture(GL_TEXTURE_2D, 0, accum);
+		GLState::bindTexture(GL_TEXTURE_2D, 1, revealage);
+		GLState::bindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		GLState::setDepthBlendState(saved);
+	}
+
+	void Delete()
+	{
+		release();
+		if (vao)
+			GLState::deleteVertexArray(vao);
+		vao = 0;
+	}
+
+private:
+	unsigned int fbo;
+	unsigned int accum, revealage;	// RGBA16F, R16F
+	unsigned int depth;				// renderbuffer
+	unsigned int vao;				// empty, for the full screen triangle
+	unsigned int width, height;
+	GLDepthBlendState saved;		// from begin()
+
+	void allocate(unsigned int width, unsigned int height)
+	{
+		release();
+		this->width = width;
+		this->height = height;
+		accum = target(GL_RGBA16F, GL_RGBA);
+		revealage = target(GL_R16F, GL_RED);
+		glGenRenderbuffers(1, &depth);
+		glBindRenderbuffer(GL_RENDERBUFFER, depth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, accum, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, revealage, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+		const GLenum buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+		glDrawBuffers(2, buffers);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::OIT::Framebuffer is not complete!" << std::endl;
+		if (!vao)
+			glGenVertexArrays(1, &vao);
+	}
+	unsigned int target(GLenum internalFormat, GLenum format)
+	{
+		unsigned int id;
+		glGenTextures(1, &id);
+		GLState::bindTexture(GL_TEXTURE_2D, id);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		return id;
+	}
+	void release()
+	{
+		if (fbo) {
+			glDeleteFramebuffers(1, &fbo);
+			glDeleteRenderbuffers(1, &depth);
+			GLState::deleteTexture(accum);
+			GLState::deleteTexture(revealage);
+		}
+		fbo = accum = revealage = depth = 0;
+		width = height = 0;
+	}
+};
+
+#endif // !OIT_H
@@ -0,0 +1,147 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "glext.h"
+
+// On-disk cache of linked program binaries. Entries are keyed by a hash of
+// the final shader sources and the driver's vendor/renderer/version
+// strings, so a driver update or a shader edit simply misses. A stale or
+// rejected binary falls back to a normal compile, which rewrites the entry.
+class ProgramCache
+{
+public:
+	// Enables the cache, an empty directory disables it (the default)
+	static void setDirectory(const std::string& dir)
+	{
+		directory = dir;
+		if (!directory.empty()) {
+			std::error_code error;
+			std::filesystem::create_directories(directory, error);
+		}
+	}
+	static bool enabled() { return !directory.empty() && GLExt.programBinary; }
+
+	// Hash of everything a binary depends on
+	static uint64_t key(const std::string& vertexCode, const std::string& fragmentCode)
+	{
+		uint64_t hash = FNV_OFFSET;
+		hash = fnv1a(hash, vertexCode);
+		hash = fnv1a(hash, fragmentCode);
+		hash = fnv1a(hash, glString(GL_VENDOR));
+		hash = fnv1a(hash, glString(GL_RENDERER));
+		hash = fnv1a(hash, glString(GL_VERSION));
+		hash = fnv1a(hash, glString(GL_SHADING_LANGUAGE_VERSION));
+		return hash;
+	}
+
+	// Load a cached binary into program. Returns false on a miss or when
+	// the driver rejects the binary, the program then has to be linked.
+	static bool load(unsigned int program, uint64_t key)
+	{
+		if (!enabled())
+			return false;
+		std::ifstream file(path(key), std::ios::binary);
+		if (!file)
+			return false;
+		Header header;
+		if (!file.read((char*)&header, sizeof(header)) || header.magic != MAGIC ||
+			header.version != VERSION || header.key != key || header.length == 0)
+			return false;
+		std::vector<char> binary(header.length);
+		if (!file.read(binary.data(), binary.size()))
+			return false;
+		glProgramBinary(program, header.format, binary.data(), header.length);
+		GLint success = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		return success == GL_TRUE;
+	}
+
+	// Ask the driver to keep the binary of a program that is about to link
+	static void prepare(unsigned int program)
+	{
+		if (enabled())
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// Write the binary of a successfully linked program
+	static void store(unsigned int program, uint64_t key)
+	{
+		if (!enabled())
+			return;
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		Header header = { MAGIC, VERSION, key, 0, 0 };
+		GLsizei written = 0;
+		glGetProgramBinary(program, length, &written, &header.format, binary.data());
+		if (written <= 0)
+			return;
+		header.length = written;
+		// write to a temporary name first so readers never see half a file
+		std::string target = path(key);
+		std::string temp = target + ".tmp";
+		{
+			std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+			if (!file.write((const char*)&header, sizeof(header)) || !file.write(binary.data(), written)) {
+				std::cout << "WARNING::PROGRAM_CACHE::Failed to write " << temp << std::endl;
+				return;
+			}
+		}
+		std::error_code error;
+		std::filesystem::rename(temp, target, error);
+	}
+
+private:
+	static const uint32_t MAGIC = 0x42504C47;	// "GLPB"
+	static const uint32_t VERSION = 1;
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t key;
+		GLenum format;
+		uint32_t length;
+	};
+
+	inline static std::string directory;
+
+	static std::string path(uint64_t key)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+		return directory + "/" + name;
+	}
+	static std::string glString(GLenum name)
+	{
+		const char* value = (const char*)glGetString(name);
+		return value ? value : "";
+	}
+	static uint64_t fnv1a(uint64_t hash, const std::string& data)
+	{
+		for (unsigned char c : data) {
+			hash ^= c;
+			hash *= FNV_PRIME;
+		}
+		// separator so ("ab", "c") and ("a", "bc") differ
+		hash ^= 0xff;
+		hash *= FNV_PRIME;
+		return hash;
+	}
+};
+
+#endif // !PROGRAM_CACHE_H
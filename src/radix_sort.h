@@ -0,0 +1,50 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Stable LSD radix sort of items by a 64 bit key, one byte per round.
+// Bytes every key has in common are skipped, which leaves few rounds for
+// small inputs. keyOf(item) returns the key of an item, scratch is resized
+// to items and worth keeping between calls.
+template <typename T, typename KeyOf>
+void radixSort64(std::vector<T>& items, std::vector<T>& scratch, KeyOf keyOf)
+{
+	if (items.size() < 2)
+		return;
+	uint64_t all = ~(uint64_t)0, any = 0;
+	for (unsigned int i = 0; i < items.size(); i++) {
+		uint64_t key = keyOf(items[i]);
+		all &= key;
+		any |= key;
+	}
+	uint64_t varying = all ^ any;
+	scratch.resize(items.size());
+	for (unsigned int shift = 0; shift < 64; shift += 8) {
+		if ((varying >> shift & 0xFF) == 0)
+			continue;
+		unsigned int offsets[256];
+		std::memset(offsets, 0, sizeof(offsets));
+		for (unsigned int i = 0; i < items.size(); i++)
+			offsets[keyOf(items[i]) >> shift & 0xFF]++;
+		unsigned int total = 0;
+		for (unsigned int b = 0; b < 256; b++) {
+			unsigned int count = offsets[b];
+			offsets[b] = total;
+			total += count;
+		}
+		for (unsigned int i = 0; i < items.size(); i++)
+			scratch[offsets[keyOf(items[i]) >> shift & 0xFF]++] = items[i];
+		items.swap(scratch);
+	}
+}
+
+// Plain keys
+inline void radixSort64(std::vector<uint64_t>& keys, std::vector<uint64_t>& scratch)
+{
+	radixSort64(keys, scratch, [](uint64_t key) { return key; });
+}
+
+#endif // !RADIX_SORT_H
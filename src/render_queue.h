@@ -0,0 +1,90 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "radix_sort.h"
+
+// Order of the layers within a pass
+enum RenderLayer {
+	RENDER_LAYER_OPAQUE,		// front to back, grouped by program and material
+	RENDER_LAYER_SKY,			// after the opaque geometry that hides most of it
+	RENDER_LAYER_TRANSPARENT	// back to front
+};
+
+// One draw: what to draw is up to the owner of the queue (kind and index
+// into its own tables), the key decides when.
+struct DrawPacket
+{
+	uint64_t key;
+	uint32_t kind;
+	uint32_t index;
+};
+
+// Draws of one frame, sorted by a 64 bit key. From the most significant bit:
+//
+//   opaque, sky   pass:4 layer:2 program:12 material:16 depth:24 unused:6
+//   transparent   pass:4 layer:2 ~depth:24 program:12 material:16 unused:6
+//
+// so a pass is drawn as a block, opaque draws switch program and material
+// as rarely as possible and transparent draws come far to near. Depth is
+// the distance from the camera divided by the far plane.
+class RenderQueue
+{
+public:
+	static uint64_t key(unsigned int pass, RenderLayer layer, unsigned int program, unsigned int material, float depth)
+	{
+		uint64_t d = quantize(depth);
+		uint64_t key = (uint64_t)(pass & 0xF) << 60 | (uint64_t)layer << 58;
+		if (layer == RENDER_LAYER_TRANSPARENT)
+			return key | (0xFFFFFF - d) << 34 | (uint64_t)(program & 0xFFF) << 22 | (uint64_t)(material & 0xFFFF) << 6;
+		return key | (uint64_t)(program & 0xFFF) << 46 | (uint64_t)(material & 0xFFFF) << 30 | d << 6;
+	}
+	static unsigned int passOf(uint64_t key) { return (unsigned int)(key >> 60); }
+
+	void clear() { packets.clear(); }
+	void push(uint64_t key, uint32_t kind, uint32_t index)
+	{
+		DrawPacket packet;
+		packet.key = key;
+		packet.kind = kind;
+		packet.index = index;
+		packets.push_back(packet);
+	}
+	unsigned int size() const { return packets.size(); }
+	const DrawPacket& operator[](unsigned int i) const { return packets[i]; }
+
+	// Stable, see radixSort64()
+	void sort()
+	{
+		radixSort64(packets, scratch, [](const DrawPacket& packet) { return packet.key; });
+	}
+
+	// Range of the sorted packets that belong to pass
+	void range(unsigned int pass, unsigned int& first, unsigned int& last) const
+	{
+		first = 0;
+		while (first < packets.size() && passOf(packets[first].key) < pass)
+			first++;
+		last = first;
+		while (last < packets.size() && passOf(packets[last].key) == pass)
+			last++;
+	}
+
+private:
+	// buffers are kept between frames
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> scratch;
+
+	static uint64_t quantize(float depth)
+	{
+		if (!(depth > 0.0f))
+			return 0;
+		if (depth >= 1.0f)
+			return 0xFFFFFF;
+		return (uint64_t)(depth * 16777215.0f);
+	}
+};
+
+#endif // !RENDER_QUEUE_H
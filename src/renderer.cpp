@@ -0,0 +1,1048 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stb/stb_image.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+#include <vector>
+
+#include "gl_state.h"
+#include "vbo.h"
+#include "ebo.h"
+#include "instances.h"
+#include "vao.h"
+#include "fbo.h"
+#include "rbo.h"
+#include "shader.h"
+#include "shader_library.h"
+#include "shader_variants.h"
+#include "camera.h"
+#include "texture.h"
+#include "material.h"
+#include "mesh.h"
+#include "frame.h"
+#include "lights.h"
+#include "transforms.h"
+#include "scene_graph.h"
+#include "culling.h"
+#include "render_queue.h"
+#include "transparent_sorter.h"
+#include "oit.h"
+#include "hiz.h"
+#include "gpu_culling.h"
+#ifdef OGL_HAS_ASSIMP
+#include "model.h"
+#endif
+#include "renderer.h"
+
+// Vertices
+static float planeVertices[] = {
+    // positions            normals               texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
+     5.0f, -0.5f, -5.0f,    0.0f, 1.0f, 0.0f,     2.0f, 0.0f,
+    -5.0f, -0.5f, -5.0f,    0.0f, 1.0f, 0.0f,     0.0f, 0.0f,
+    -5.0f, -0.5f,  5.0f,    0.0f, 1.0f, 0.0f,     0.0f, 2.0f,
+     5.0f, -0.5f,  5.0f,    0.0f, 1.0f, 0.0f,     2.0f, 2.0f
+};
+
+static float quadVertices[] = {
+    // positions          normals              texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
+     0.0f,  0.5f, 0.0f,   0.0f, 0.0f, 1.0f,    0.0f, 1.0f,
+     0.0f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,    0.0f, 0.0f,
+     1.0f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,    1.0f, 0.0f,
+     1.0f,  0.5f, 0.0f,   0.0f, 0.0f, 1.0f,    1.0f, 1.0f
+};
+static float screenVertices[] = {
+    // positions          texture Coords (note we set these higher than 1 (together with GL_REPEAT as texture wrapping mode). this will cause the floor texture to repeat)
+    -1.0f / 2.0f,  1.0f / 2.0f, 0.0f,   0.0f, 1.0f,
+    -1.0f / 2.0f, -1.0f / 2.0f, 0.0f,   0.0f, 0.0f,
+     1.0f / 2.0f, -1.0f / 2.0f, 0.0f,   1.0f, 0.0f,
+     1.0f / 2.0f,  1.0f / 2.0f, 0.0f,   1.0f, 1.0f
+};
+
+static float cubeVertices[] = {
+    // positions
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f,  1.0f,    0.0f, 0.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f, 0.0f,
+
+    -1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f,  1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f,  1.0f,    0.0f, 0.0f
+};
+
+static unsigned int indices[] = {
+    0, 1, 2,
+    0, 2, 3
+};
+
+// Unit box with a normal per face, for the glass blocks
+static float boxVertices[] = {
+    // positions            normals               texture Coords
+    // right
+     1.0f, -1.0f,  1.0f,    1.0f,  0.0f,  0.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    1.0f,  0.0f,  0.0f,    1.0f, 0.0f,
+     1.0f,  1.0f, -1.0f,    1.0f,  0.0f,  0.0f,    1.0f, 1.0f,
+     1.0f,  1.0f,  1.0f,    1.0f,  0.0f,  0.0f,    0.0f, 1.0f,
+    // left
+    -1.0f, -1.0f, -1.0f,   -1.0f,  0.0f,  0.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f,  1.0f,   -1.0f,  0.0f,  0.0f,    1.0f, 0.0f,
+    -1.0f,  1.0f,  1.0f,   -1.0f,  0.0f,  0.0f,    1.0f, 1.0f,
+    -1.0f,  1.0f, -1.0f,   -1.0f,  0.0f,  0.0f,    0.0f, 1.0f,
+    // top
+    -1.0f,  1.0f,  1.0f,    0.0f,  1.0f,  0.0f,    0.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f,  1.0f,  0.0f,    1.0f, 0.0f,
+     1.0f,  1.0f, -1.0f,    0.0f,  1.0f,  0.0f,    1.0f, 1.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f,  1.0f,  0.0f,    0.0f, 1.0f,
+    // bottom
+    -1.0f, -1.0f, -1.0f,    0.0f, -1.0f,  0.0f,    0.0f, 0.0f,
+     1.0f, -1.0f, -1.0f,    0.0f, -1.0f,  0.0f,    1.0f, 0.0f,
+     1.0f, -1.0f,  1.0f,    0.0f, -1.0f,  0.0f,    1.0f, 1.0f,
+    -1.0f, -1.0f,  1.0f,    0.0f, -1.0f,  0.0f,    0.0f, 1.0f,
+    // front
+    -1.0f, -1.0f,  1.0f,    0.0f,  0.0f,  1.0f,    0.0f, 0.0f,
+     1.0f, -1.0f,  1.0f,    0.0f,  0.0f,  1.0f,    1.0f, 0.0f,
+     1.0f,  1.0f,  1.0f,    0.0f,  0.0f,  1.0f,    1.0f, 1.0f,
+    -1.0f,  1.0f,  1.0f,    0.0f,  0.0f,  1.0f,    0.0f, 1.0f,
+    // back
+     1.0f, -1.0f, -1.0f,    0.0f,  0.0f, -1.0f,    0.0f, 0.0f,
+    -1.0f, -1.0f, -1.0f,    0.0f,  0.0f, -1.0f,    1.0f, 0.0f,
+    -1.0f,  1.0f, -1.0f,    0.0f,  0.0f, -1.0f,    1.0f, 1.0f,
+     1.0f,  1.0f, -1.0f,    0.0f,  0.0f, -1.0f,    0.0f, 1.0f
+};
+
+static unsigned int boxIndices[] = {
+     0,  1,  2,  0,  2,  3,
+     4,  5,  6,  4,  6,  7,
+     8,  9, 10,  8, 10, 11,
+    12, 13, 14, 12, 14, 15,
+    16, 17, 18, 16, 18, 19,
+    20, 21, 22, 20, 22, 23
+};
+
+// Decoded textures uploaded at the start of a frame while assets stream in
+static const unsigned int TEXTURE_UPLOADS_PER_FRAME = 4;
+
+// What a DrawPacket of the scene draws and what its index is
+enum SceneDraw {
+    DRAW_BACKPACK,          // one mesh
+    DRAW_BACKPACK_PACKED,   // a material run of the visible meshes, multi draw indirect
+    DRAW_BACKPACK_CULLED,   // a bucket of the GPU culling, multi draw indirect
+    DRAW_BACKPACK_INSTANCES,    // the small copies in view, instanced
+    DRAW_FLOOR,
+    DRAW_BLOCK,             // index is the block
+    DRAW_BLOCKS_CULLED,     // a bucket of the GPU culling, multi draw indirect
+    DRAW_SKY
+};
+// Material part of the sort keys, the backpack materials follow the others
+enum SceneMaterialKey {
+    MATERIAL_KEY_FLOOR = 1,
+    MATERIAL_KEY_SKY,
+    MATERIAL_KEY_BLOCK,
+    MATERIAL_KEY_MODEL
+};
+
+// All GL objects of the demo scene, in construction order
+struct Scene
+{
+    SceneSetup setup;
+    std::vector<glm::vec3> vegetation;
+    // the glass blocks of the benchmark scene hang below one root node, one
+    // of them spins
+    SceneGraph props;
+    std::vector<unsigned int> blocks;   // node of each block
+    unsigned int spinningBlock;
+    unsigned int frame;
+    // transforms of the visible vegetation, one instanced draw per view
+    InstanceBuffer grassInstances;
+
+    VAO planeVAO;
+    VBO planeVBO;
+    EBO planeEBO;
+    VAO quadVAO;
+    VBO quadVBO;
+    EBO quadEBO;
+    VAO screenVAO;
+    VBO screenVBO;
+    EBO screenEBO;
+    VAO skyVAO;
+    VBO skyVBO;
+    VAO boxVAO;
+    VBO boxVBO;
+    EBO boxEBO;
+
+    ShaderLibrary shaders;
+    // set once loading is wrapped up, by finishLoading() or the first frame
+    bool loaded;
+    // what of the model geometry stays in system memory after that
+    bool keepCompressedGeometry;
+    // Permutations of the lit program, picked per material and light setup
+    ShaderVariants litShaders;
+    Shader& outlineShader;
+    Shader& simpleShader;
+    Shader& screenShader;
+    Shader& skyShader;
+    Shader& reflectShader;
+    Shader& reflectIndirectShader;
+    Shader& reflectInstancedShader;
+    Shader& oitShader;
+    Shader& oitCompositeShader;
+    Shader& cullShader;
+    Shader& hizShader;
+
+#ifdef OGL_HAS_ASSIMP
+    Model ourModel;
+    // small copies of the model on the floor in the benchmark scene, drawn
+    // instanced
+    std::vector<glm::mat4> smallBackpacks;
+    InstanceBuffer backpackInstances;
+    // around all meshes of the model, for culling the copies
+    MeshBounds modelBounds;
+#endif
+
+    Texture floorTexture;
+    // the floor and its lit program
+    MaterialLibrary materials;
+    unsigned int floorMaterial;
+    Texture grassTexture;
+    Texture windowTexture;
+    Cubemap skybox;
+
+    FBO fbo;
+    Texture bufferTexture;
+    RBO rbo;
+
+    // camera constants of the mirror and the main view
+    FrameUniforms frameUniforms;
+    LightManager lights;
+    // per object model and normal matrices, rebuilt every frame
+    TransformBatch transforms;
+    // object space bounds of the built in quads
+    MeshBounds planeBounds;
+    MeshBounds quadBounds;
+    MeshBounds boxBounds;
+    // world bounds of everything drawn, tested once per view
+    FrustumCuller culler;
+    unsigned int backpackBounds, smallBackpackBounds, floorBounds, grassBounds, blockBounds;
+    // the draws of the model and the blocks when they are culled on the
+    // GPU instead
+    GPUCuller modelCuller;
+    GPUCuller blockCuller;
+    bool gpuCulling;
+    // depth of the mirror and the main view for occlusion culling on top
+    HiZPyramid mirrorHiZ;
+    HiZPyramid mainHiZ;
+    bool occlusionCulling;
+    // opaque draws and the sky of the current view, sorted by key
+    RenderQueue queue;
+    // vegetation far to near, shared by both views of a frame
+    TransparentSorter grassOrder;
+    // accumulation targets of the mirror and the main view
+    TransparencyMode grassTransparency;
+    WeightedOIT mirrorOIT;
+    WeightedOIT mainOIT;
+    // features of the lit programs for the uploaded lights
+    ShaderFeatures litFeatures;
+    Shader* floorShader;
+    unsigned int backpackTransform, floorTransform, blockTransform;
+
+    Scene(const std::string& root, unsigned int width, unsigned int height, SceneSetup setup) :
+        setup(setup),
+        spinningBlock(0), frame(0),
+        planeVBO(planeVertices, sizeof(planeVertices)),
+        planeEBO(indices, sizeof(indices)),
+        quadVBO(quadVertices, sizeof(quadVertices)),
+        quadEBO(indices, sizeof(indices)),
+        screenVBO(screenVertices, sizeof(screenVertices)),
+        screenEBO(indices, sizeof(indices)),
+        skyVBO(cubeVertices, sizeof(cubeVertices)),
+        boxVBO(boxVertices, sizeof(boxVertices)),
+        boxEBO(boxIndices, sizeof(boxIndices)),
+        loaded(false), keepCompressedGeometry(false),
+        // Shaders, compiled in parallel while the textures load. The outline
+        // and screen programs are only needed on demand.
+        litShaders(root + "shaders/vertex.vert", root + "shaders/fragment.frag", SHADER_LOAD_ASYNC),
+        outlineShader(shaders.add("outline", root + "shaders/outline.vert", root + "shaders/outline.frag", SHADER_LOAD_DEFERRED)),
+        simpleShader(shaders.add("simple", root + "shaders/simple.vert", root + "shaders/simple.frag", SHADER_LOAD_ASYNC, "#define INSTANCED\n")),
+        screenShader(shaders.add("screen", root + "shaders/screen.vert", root + "shaders/screen.frag", SHADER_LOAD_DEFERRED)),
+        skyShader(shaders.add("sky", root + "shaders/cubemap.vert", root + "shaders/cubemap.frag")),
+        reflectShader(shaders.add("reflect", root + "shaders/vertex.vert", root + "shaders/refraction.frag")),
+        reflectIndirectShader(shaders.add("reflect_indirect", root + "shaders/indirect.vert", root + "shaders/refraction.frag", SHADER_LOAD_DEFERRED)),
+        reflectInstancedShader(shaders.add("reflect_instanced", root + "shaders/vertex.vert", root + "shaders/refraction.frag", SHADER_LOAD_DEFERRED,
+            "#define INSTANCED\n")),
+        oitShader(shaders.add("oit", root + "shaders/simple.vert", root + "shaders/oit.frag", SHADER_LOAD_DEFERRED, "#define INSTANCED\n")),
+        oitCompositeShader(shaders.add("oit_composite", root + "shaders/oit_composite.vert", root + "shaders/oit_composite.frag", SHADER_LOAD_DEFERRED)),
+        cullShader(shaders.addCompute("cull", root + "shaders/cull.comp")),
+        hizShader(shaders.add("hiz", root + "shaders/oit_composite.vert", root + "shaders/hiz.frag", SHADER_LOAD_DEFERRED)),
+#ifdef OGL_HAS_ASSIMP
+        // Model, its geometry is kept until loading is finished
+        ourModel((root + "models/backpack/backpack.obj").c_str(), RESIDENCY_KEEP),
+#endif
+        // Load other textures
+        floorTexture((root + "textures/marble.jpg").c_str(),
+            GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR),
+        floorMaterial(0),
+        grassTexture((root + "textures/grass.png").c_str(),
+            GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR),
+        windowTexture((root + "textures/window.png").c_str(),
+            GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR),
+        skybox(std::vector<std::string>{
+            root + "textures/skybox/right.jpg",
+            root + "textures/skybox/left.jpg",
+            root + "textures/skybox/top.jpg",
+            root + "textures/skybox/bottom.jpg",
+            root + "textures/skybox/front.jpg",
+            root + "textures/skybox/back.jpg"
+        }),
+        // Render to texture
+        bufferTexture(width / 2, height / 2, GL_RGB),
+        rbo(width / 2, height / 2, GL_DEPTH24_STENCIL8),
+        frameUniforms(2),
+        planeBounds(MeshBounds::of(planeVertices, 4, 8)),
+        quadBounds(MeshBounds::of(quadVertices, 4, 8)),
+        boxBounds(MeshBounds::of(boxVertices, 24, 8)),
+        backpackBounds(0), smallBackpackBounds(0), floorBounds(0), grassBounds(0), blockBounds(0),
+        gpuCulling(false), occlusionCulling(false),
+        grassTransparency(TRANSPARENCY_SORTED),
+        floorShader(NULL), backpackTransform(0), floorTransform(0), blockTransform(0)
+    {
+        // specular comes from the diffuse texture
+        Material floor;
+        floor.maps[MATERIAL_MAP_DIFFUSE] = floorTexture.handle;
+        floor.shininess = 32.0f;
+        floorMaterial = materials.add(floor);
+
+#ifdef OGL_HAS_ASSIMP
+        glm::vec3 smallBackpackPositions[] = {
+            glm::vec3(-0.6f, -0.3f, 0.8f),
+            glm::vec3(0.9f, -0.3f, 0.5f),
+            glm::vec3(-2.5f, -0.3f, -2.5f)
+        };
+        for (unsigned int i = 0; i < 3 && setup == SCENE_BENCHMARK; i++) {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), smallBackpackPositions[i]);
+            model = glm::rotate(model, glm::radians(70.0f * i - 40.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+            smallBackpacks.push_back(glm::scale(model, glm::vec3(0.15f)));
+        }
+#endif
+
+        vegetation.push_back(glm::vec3(-1.5f, 0.0f, -0.48f));
+        vegetation.push_back(glm::vec3(1.5f, 0.0f, 0.51f));
+        vegetation.push_back(glm::vec3(0.0f, 0.0f, 0.7f));
+        vegetation.push_back(glm::vec3(-0.3f, 0.0f, -2.3f));
+        vegetation.push_back(glm::vec3(0.5f, 0.0f, -0.6f));
+
+        unsigned int propsRoot = props.addNode(SceneGraph::NO_PARENT, glm::mat4(1.0f));
+        if (setup == SCENE_BENCHMARK) {
+            // a box that spins, so the scene graph has a node to update
+            spinningBlock = props.addNode(propsRoot, spinningBlockLocal(0));
+            blocks.push_back(spinningBlock);
+            // a wall behind the model and a slab, scaled unevenly for the
+            // normal matrices of TransformBatch
+            blocks.push_back(props.addNode(propsRoot, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.25f, -3.5f)),
+                glm::vec3(1.5f, 0.75f, 0.1f))));
+            blocks.push_back(props.addNode(propsRoot, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-2.0f, -0.3f, -1.2f)),
+                glm::vec3(0.4f, 0.2f, 0.3f))));
+            // small boxes behind the wall, hidden from the camera, for
+            // occlusion culling to skip
+            for (int i = -1; i <= 1; i++)
+                blocks.push_back(props.addNode(propsRoot, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.8f * i, -0.3f, -4.5f)),
+                    glm::vec3(0.2f))));
+        }
+
+        // plane VAO
+        planeVAO.bind();
+        planeVAO.linkVBO(planeVBO);
+        planeVAO.linkEBO(planeEBO);
+        planeVAO.setAttributes();
+        planeVAO.unbind();
+
+        // quad VAO
+        quadVAO.bind();
+        quadVAO.linkVBO(quadVBO);
+        quadVAO.linkEBO(quadEBO);
+        quadVAO.setAttributes();
+        quadVAO.linkInstances(grassInstances);
+        quadVAO.unbind();
+
+        // screen VAO
+        screenVAO.bind();
+        screenVAO.linkVBO(screenVBO);
+        screenVAO.linkEBO(screenEBO);
+        screenVAO.setAttributes(false);
+        screenVAO.unbind();
+
+        // skybox VAO
+        skyVAO.bind();
+        skyVAO.linkVBO(skyVBO);
+        skyVAO.setAttributes(false);
+        skyVAO.unbind();
+
+        // box VAO
+        boxVAO.bind();
+        boxVAO.linkVBO(boxVBO);
+        boxVAO.linkEBO(boxEBO);
+        boxVAO.setAttributes();
+        boxVAO.unbind();
+
+        // Render to texture
+        fbo.bind();
+        bufferTexture.attach(GL_COLOR_ATTACHMENT0);
+        rbo.bind();
+        rbo.attach(GL_DEPTH_STENCIL_ATTACHMENT);
+        fbo.check_status();
+        fbo.unbind();
+    }
+
+    ~Scene()
+    {
+        // Clear objects
+        planeVAO.Delete();
+        quadVAO.Delete();
+        screenVAO.Delete();
+        skyVAO.Delete();
+        boxVAO.Delete();
+        planeVBO.Delete();
+        quadVBO.Delete();
+        screenVBO.Delete();
+        skyVBO.Delete();
+        boxVBO.Delete();
+        planeEBO.Delete();
+        quadEBO.Delete();
+        boxEBO.Delete();
+        grassInstances.Delete();
+        screenEBO.Delete();
+        rbo.Delete();
+        fbo.Delete();
+        frameUniforms.Delete();
+        TextureLoader::shared().Delete();
+        lights.Delete();
+        mirrorOIT.Delete();
+        mainOIT.Delete();
+        modelCuller.Delete();
+        blockCuller.Delete();
+        mirrorHiZ.Delete();
+        mainHiZ.Delete();
+#ifdef OGL_HAS_ASSIMP
+        ourModel.Delete();
+        backpackInstances.Delete();
+#endif
+        shaders.Delete();
+        litShaders.Delete();
+    }
+
+    // Turned box on the floor, spinning a degree per frame
+    static glm::mat4 spinningBlockLocal(unsigned int frame)
+    {
+        glm::mat4 local = glm::translate(glm::mat4(1.0f), glm::vec3(2.2f, -0.25f, -2.0f));
+        local = glm::rotate(local, glm::radians(30.0f + frame), glm::vec3(0.0f, 1.0f, 0.0f));
+        return glm::scale(local, glm::vec3(0.25f));
+    }
+
+    // Wait for the programs still compiling and drop the system memory
+    // copies of the geometry, everything is on the GPU by now
+    void finishLoading()
+    {
+        shaders.finishAll();
+#ifdef OGL_HAS_ASSIMP
+        ourModel.setResidency(keepCompressedGeometry ? RESIDENCY_KEEP_COMPRESSED : RESIDENCY_DISCARD);
+#endif
+        loaded = true;
+    }
+
+    // Every program reads its camera from the FrameConstants block
+    void bindFrameConstants()
+    {
+        shaders.bindUniformBlock("FrameConstants", FRAME_CONSTANTS_BINDING);
+        shaders.bindUniformBlock("Lights", LIGHTS_BINDING);
+        litShaders.bindUniformBlock("FrameConstants", FRAME_CONSTANTS_BINDING);
+        litShaders.bindUniformBlock("Lights", LIGHTS_BINDING);
+    }
+
+    // Hand the blocks to blockCuller in one bucket, they share every state.
+    // Again after their transforms changed.
+    void addBlockDraws()
+    {
+        DrawCommand command;
+        command.count = 36;
+        command.instanceCount = 1;
+        command.firstIndex = 0;
+        command.baseVertex = 0;
+        command.baseInstance = 0;
+        blockCuller.clear();
+        for (unsigned int i = 0; i < blocks.size(); i++) {
+            DrawData draw;
+            draw.model = transforms.model(blockTransform + i);
+            const glm::mat3& normal = transforms.normal(blockTransform + i);
+            for (int c = 0; c < 3; c++)
+                draw.normalMatrix[c] = glm::vec4(normal[c], 0.0f);
+            draw.material = 0;
+            blockCuller.add(command, draw, boxBounds, 0);
+        }
+        blockCuller.upload();
+    }
+
+    // Bounds of the objects of a view, culled against its frustum. With
+    // occlusion culling the GPU culled draws are also tested against hiz,
+    // the depth of the view in the previous frame.
+    void cull(const glm::mat4& viewProjection, const HiZPyramid& hiz)
+    {
+        Frustum frustum = Frustum::fromMatrix(viewProjection);
+        const HiZPyramid* occluders = occlusionCulling ? &hiz : NULL;
+        culler.clear();
+#ifdef OGL_HAS_ASSIMP
+        if (gpuCulling)
+            modelCuller.cull(cullShader, frustum, occluders);
+        else
+            backpackBounds = ourModel.addBounds(culler, transforms, backpackTransform);
+        smallBackpackBounds = culler.size();
+        for (unsigned int i = 0; i < smallBackpacks.size(); i++)
+            culler.add(modelBounds, smallBackpacks[i]);
+#endif
+        floorBounds = culler.add(planeBounds, glm::mat4(1.0f));
+        if (gpuCulling)
+            blockCuller.cull(cullShader, frustum, occluders);
+        else {
+            blockBounds = culler.size();
+            for (unsigned int i = 0; i < blocks.size(); i++)
+                culler.add(boxBounds, transforms.model(blockTransform + i));
+        }
+        grassBounds = culler.size();
+        for (unsigned int i = 0; i < vegetation.size(); i++)
+            culler.add(quadBounds, glm::translate(glm::mat4(1.0f), vegetation[i]));
+        culler.cull(frustum);
+    }
+
+    // Queue what is visible after cull(), sorted for pass
+    void queueView(unsigned int pass, const glm::vec3& eye)
+    {
+        queue.clear();
+#ifdef OGL_HAS_ASSIMP
+        // the model is drawn by material either way, a packet per material
+        // at the depth of its nearest mesh
+        if (gpuCulling) {
+            // visibility is only known on the GPU, every mesh counts
+            for (unsigned int b = 0; b < modelCuller.bucketCount(); b++) {
+                unsigned int material = modelCuller.bucketKey(b);
+                float depth = ourModel.materialDistance(material, transforms, backpackTransform, eye) / FAR_PLANE;
+                queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectIndirectShader.ID, MATERIAL_KEY_MODEL + material,
+                    std::min(depth, 1.0f)), DRAW_BACKPACK_CULLED, b);
+            }
+        }
+        else if (GLExt.multiDrawIndirect) {
+            unsigned int runs = ourModel.packVisible(transforms, backpackTransform, culler, backpackBounds, eye);
+            for (unsigned int r = 0; r < runs; r++) {
+                const Model::PackedRun& run = ourModel.packedRun(r);
+                queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectIndirectShader.ID, MATERIAL_KEY_MODEL + run.material,
+                    std::min(run.distance / FAR_PLANE, 1.0f)), DRAW_BACKPACK_PACKED, r);
+            }
+        }
+        else {
+            for (unsigned int i = 0; i < ourModel.meshCount(); i++) {
+                if (culler.visible(backpackBounds + i))
+                    queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectShader.ID, MATERIAL_KEY_MODEL + ourModel.materialOf(i),
+                        depthOf(eye, backpackBounds + i)), DRAW_BACKPACK, i);
+            }
+        }
+        // the small copies in view, at the depth of the nearest
+        backpackInstances.clear();
+        float instancesDepth = 1.0f;
+        for (unsigned int i = 0; i < smallBackpacks.size(); i++) {
+            if (!culler.visible(smallBackpackBounds + i))
+                continue;
+            backpackInstances.add(smallBackpacks[i]);
+            instancesDepth = std::min(instancesDepth, depthOf(eye, smallBackpackBounds + i));
+        }
+        if (backpackInstances.size() > 0 && ourModel.meshCount() > 0) {
+            backpackInstances.upload();
+            queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectInstancedShader.ID, MATERIAL_KEY_MODEL + ourModel.materialOf(0),
+                instancesDepth),
+                DRAW_BACKPACK_INSTANCES, 0);
+        }
+#endif
+        if (culler.visible(floorBounds))
+            queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, floorShader->ID, MATERIAL_KEY_FLOOR,
+                depthOf(eye, floorBounds)), DRAW_FLOOR, 0);
+        if (gpuCulling) {
+            // at the depth of the nearest block, visible or not
+            float depth = 1.0f;
+            for (unsigned int i = 0; i < blocks.size(); i++)
+                depth = std::min(depth, glm::length(glm::vec3(transforms.model(blockTransform + i)[3]) - eye) / FAR_PLANE);
+            for (unsigned int b = 0; b < blockCuller.bucketCount(); b++)
+                queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectIndirectShader.ID, MATERIAL_KEY_BLOCK, depth),
+                    DRAW_BLOCKS_CULLED, b);
+        }
+        else {
+            for (unsigned int i = 0; i < blocks.size(); i++) {
+                if (culler.visible(blockBounds + i))
+                    queue.push(RenderQueue::key(pass, RENDER_LAYER_OPAQUE, reflectShader.ID, MATERIAL_KEY_BLOCK,
+                        depthOf(eye, blockBounds + i)), DRAW_BLOCK, i);
+            }
+        }
+        queue.push(RenderQueue::key(pass, RENDER_LAYER_SKY, skyShader.ID, MATERIAL_KEY_SKY, 1.0f), DRAW_SKY, 0);
+        queue.sort();
+    }
+    float depthOf(const glm::vec3& eye, unsigned int bounds) const
+    {
+        return glm::length(culler.center(bounds) - eye) / FAR_PLANE;
+    }
+
+    // After the opaque objects of a view: rebuild its depth pyramid and draw
+    // the GPU culled draws cull() hid behind the old one that the new one
+    // does not hide, so nothing pops in a frame late
+    void retestOccluded(unsigned int target, unsigned int width, unsigned int height, const glm::mat4& viewProjection,
+        HiZPyramid& hiz)
+    {
+        if (!gpuCulling || !occlusionCulling)
+            return;
+        if (!hiz.build(target, width, height, viewProjection, hizShader))
+            return;
+        blockCuller.retest(cullShader, hiz);
+        for (unsigned int b = 0; b < blockCuller.bucketCount(); b++)
+            drawBlocksCulled(b);
+#ifdef OGL_HAS_ASSIMP
+        modelCuller.retest(cullShader, hiz);
+        reflectIndirectShader.use();
+        skybox.activate(reflectIndirectShader, "skybox", 0);
+        for (unsigned int b = 0; b < modelCuller.bucketCount(); b++)
+            ourModel.DrawCulled(reflectIndirectShader, modelCuller, b);
+#endif
+    }
+
+    // Program and textures are set per packet, GLState and the uniform
+    // shadows drop what the previous packet already set
+    void draw(const DrawPacket& packet)
+    {
+        switch (packet.kind) {
+        case DRAW_BACKPACK:
+#ifdef OGL_HAS_ASSIMP
+            reflectShader.use();
+            skybox.activate(reflectShader, "skybox", 0);
+            transforms.apply(reflectShader, backpackTransform + packet.index);
+            ourModel.DrawMesh(reflectShader, packet.index);
+#endif
+            break;
+        case DRAW_BACKPACK_PACKED:
+#ifdef OGL_HAS_ASSIMP
+            reflectIndirectShader.use();
+            skybox.activate(reflectIndirectShader, "skybox", 0);
+            ourModel.DrawPackedRun(reflectIndirectShader, packet.index);
+#endif
+            break;
+        case DRAW_BACKPACK_CULLED:
+#ifdef OGL_HAS_ASSIMP
+            reflectIndirectShader.use();
+            skybox.activate(reflectIndirectShader, "skybox", 0);
+            ourModel.DrawCulled(reflectIndirectShader, modelCuller, packet.index);
+#endif
+            break;
+        case DRAW_BACKPACK_INSTANCES:
+#ifdef OGL_HAS_ASSIMP
+            reflectInstancedShader.use();
+            skybox.activate(reflectInstancedShader, "skybox", 0);
+            ourModel.DrawInstanced(reflectInstancedShader, backpackInstances);
+#endif
+            break;
+        case DRAW_FLOOR:
+            floorShader->use();
+            transforms.apply(*floorShader, floorTransform);
+            planeVAO.bind();
+            materials.bind(*floorShader, materials.bindings(*floorShader), floorMaterial);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            break;
+        case DRAW_BLOCK:
+            reflectShader.use();
+            skybox.activate(reflectShader, "skybox", 0);
+            transforms.apply(reflectShader, blockTransform + packet.index);
+            boxVAO.bind();
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            break;
+        case DRAW_BLOCKS_CULLED:
+            drawBlocksCulled(packet.index);
+            break;
+        case DRAW_SKY:
+            glDepthFunc(GL_LEQUAL);
+            skyShader.use();
+            skyVAO.bind();
+            skybox.activate(skyShader, "cubemap", 0);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            glDepthFunc(GL_LESS);
+            break;
+        }
+    }
+    // One bucket of what blockCuller left
+    void drawBlocksCulled(unsigned int bucket)
+    {
+        reflectIndirectShader.use();
+        skybox.activate(reflectIndirectShader, "skybox", 0);
+        boxVAO.bind();
+        blockCuller.draw(reflectIndirectShader, bucket);
+    }
+    void drawQueue(unsigned int pass)
+    {
+        unsigned int first, last;
+        queue.range(pass, first, last);
+        for (unsigned int i = first; i < last; i++)
+            draw(queue[i]);
+    }
+
+    bool weightedGrass() const
+    {
+        return grassTransparency == TRANSPARENCY_WEIGHTED && WeightedOIT::supported();
+    }
+    // Vegetation of the current view, drawn into target (width x height)
+    // after the opaque objects. Sorted mode needs grassOrder to be sorted.
+    void drawGrass(unsigned int target, unsigned int width, unsigned int height, WeightedOIT& oit)
+    {
+        bool weighted = weightedGrass();
+        // instances are drawn in order, which keeps the sort
+        grassInstances.clear();
+        for (unsigned int i = 0; i < vegetation.size(); i++)
+        {
+            unsigned int quad = weighted ? i : grassOrder[i];
+            if (culler.visible(grassBounds + quad))
+                grassInstances.add(glm::translate(glm::mat4(1.0f), vegetation[quad]));
+        }
+        if (grassInstances.size() == 0)
+            return;
+        grassInstances.upload();
+
+        Shader& shader = weighted ? oitShader : simpleShader;
+        if (weighted)
+            oit.begin(target, width, height);
+        shader.use();
+        shader.setMat4("model", glm::mat4(1.0f));
+        quadVAO.bind();
+        grassTexture.activate(shader, "texture_diffuse1", 0);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, grassInstances.size());
+        if (weighted)
+            oit.composite(target, oitCompositeShader);
+    }
+
+    // Cheapest lit variant of the floor for the uploaded lights, call after
+    // lights.upload(). The material caches its pick, so this only looks for
+    // a new program after the light counts changed.
+    void selectLitPrograms()
+    {
+        litFeatures = ShaderFeatures();
+        litFeatures.setLightCounts(lights.uploadedCounts());
+        floorShader = &materials.program(floorMaterial, litShaders, litFeatures);
+    }
+};
+
+Renderer::Renderer(const std::string& root, unsigned int width, unsigned int height, SceneSetup setup) :
+    scene(new Scene(root, width, height, setup)), width(width), height(height), targetFBO(0)
+{
+    scene->bindFrameConstants();
+
+    // Lights
+    LightManager& lights = scene->lights;
+    glm::vec3 pointLightPositions[] = {
+        glm::vec3(0.7f,  0.2f,  2.0f),
+        glm::vec3(2.3f, -3.3f, -4.0f),
+        glm::vec3(-4.0f,  2.0f, -12.0f),
+        glm::vec3(0.0f,  0.0f, -3.0f)
+    };
+    // dir light
+    DirLight dirLight;
+    dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    dirLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    dirLight.specular = glm::vec3(0.4f, 0.4f, 0.4f);
+    lights.addDirLight(dirLight);
+    // point lights
+    for (unsigned int i = 0; i < 4; i++) {
+        PointLight pointLight;
+        pointLight.position = pointLightPositions[i];
+        pointLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+        pointLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+        pointLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+        pointLight.constant = 1.0f;
+        pointLight.linear = 0.09f;
+        pointLight.quadratic = 0.032f;
+        lights.addPointLight(pointLight);
+    }
+
+    // spot light
+    // (aimed along the starting camera, the main loop never moves it)
+    Camera camera(glm::vec3(1.0f, 1.5f, 3.0f), glm::vec3(0.0f, 1.0f, 0.0f), -100, -20);
+    SpotLight spotLight;
+    spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    spotLight.diffuse = glm::vec3(0.0f, 0.0f, 0.0f);
+    spotLight.specular = glm::vec3(0.0f, 0.0f, 0.0f);
+    spotLight.constant = 1.0f;
+    spotLight.linear = 0.09f;
+    spotLight.quadratic = 0.032f;
+    spotLight.position = camera.Position;
+    spotLight.direction = camera.Front;
+    spotLight.cutOff = glm::cos(glm::radians(12.5f));
+    spotLight.outerCutOff = glm::cos(glm::radians(17.5f));
+    lights.addSpotLight(spotLight);
+    lights.upload();
+
+    // the model and the textures were loaded while the driver compiled,
+    // take what is done already
+    scene->shaders.poll();
+
+    // compile the variant of the floor material before the first frame
+    scene->selectLitPrograms();
+
+    // Enable depht test
+    GLState::enable(GL_DEPTH_TEST, true);
+    glDepthFunc(GL_LESS);
+
+    // Face culling
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glFrontFace(GL_CCW);
+
+    // Enable stencil testing
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    // Enable blending
+    GLState::enable(GL_BLEND, true);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Enable wireframe mode
+    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+}
+
+Renderer::~Renderer() {}
+
+void Renderer::resize(unsigned int width, unsigned int height)
+{
+    this->width = width;
+    this->height = height;
+}
+
+void Renderer::finishLoading()
+{
+    scene->shaders.poll();
+    TextureLoader::shared().finish();
+    scene->finishLoading();
+}
+
+unsigned int Renderer::programsReady() const
+{
+    return scene->shaders.count(SHADER_READY);
+}
+
+unsigned int Renderer::programsCompiling() const
+{
+    return scene->shaders.count(SHADER_COMPILING);
+}
+
+void Renderer::setKeepCompressedGeometry(bool enabled)
+{
+    scene->keepCompressedGeometry = enabled;
+}
+
+size_t Renderer::geometryBytes() const
+{
+#ifdef OGL_HAS_ASSIMP
+    return scene->ourModel.cpuBytes();
+#else
+    return 0;
+#endif
+}
+
+unsigned int Renderer::updatedNodes() const
+{
+#ifdef OGL_HAS_ASSIMP
+    return scene->props.updatedNodes() + scene->ourModel.nodes().updatedNodes();
+#else
+    return scene->props.updatedNodes();
+#endif
+}
+
+unsigned int Renderer::visibleObjects() const
+{
+    return scene->culler.visibleObjects();
+}
+
+unsigned int Renderer::culledObjects() const
+{
+    return scene->culler.culledObjects();
+}
+
+void Renderer::resetCullingCounters()
+{
+    scene->culler.resetCounters();
+}
+
+unsigned int Renderer::occludedObjects() const
+{
+#ifdef OGL_HAS_ASSIMP
+    return scene->blockCuller.occludedCount() + scene->modelCuller.occludedCount();
+#else
+    return scene->blockCuller.occludedCount();
+#endif
+}
+
+void Renderer::setWeightedTransparency(bool enabled)
+{
+    scene->grassTransparency = enabled ? TRANSPARENCY_WEIGHTED : TRANSPARENCY_SORTED;
+}
+
+bool Renderer::setGPUCulling(bool enabled)
+{
+    scene->gpuCulling = enabled && GPUCuller::supported();
+    return scene->gpuCulling == enabled;
+}
+
+bool Renderer::setOcclusionCulling(bool enabled)
+{
+    scene->occlusionCulling = enabled && scene->gpuCulling;
+    return scene->occlusionCulling == enabled;
+}
+
+void Renderer::renderFrame(Camera& camera, bool zoom)
+{
+    Scene& s = *scene;
+
+    // a few decoded textures per frame replace their placeholders
+    TextureLoader::shared().update(TEXTURE_UPLOADS_PER_FRAME);
+    // programs still compiling are waited for once, not at their first use
+    // somewhere in the frame
+    if (!s.loaded)
+        s.finishLoading();
+
+    // Rendering
+    // First pass to texture
+    s.fbo.bind();
+    glViewport(0, 0, width / 2, height / 2);
+    GLState::enable(GL_DEPTH_TEST, true);
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+    // projection matrix
+    glm::mat4 projection = glm::perspective(glm::radians(15.0f), (float)width / (float)height, NEAR_PLANE, FAR_PLANE);
+    // camera/view matrix
+    glm::mat4 view = camera.GetViewMatrix();
+    // model matrix
+    glm::mat4 model = glm::mat4(1.0f);
+
+    // camera constants for this view
+    s.frameUniforms.setView(0, projection, view, camera.Position);
+    s.frameUniforms.use(0);
+    // no-op unless lights changed
+    s.lights.upload();
+
+    // lit program of the floor
+    s.selectLitPrograms();
+
+    // object transforms, normal matrices for all of them in one batch
+    s.transforms.clear();
+    model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0f)); // translate it down so it's at the center of the scene
+    model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f));	// it's a bit too big for our scene, so scale it down
+    // one transform per backpack mesh, from its node in the asset
+#ifdef OGL_HAS_ASSIMP
+    s.backpackTransform = s.ourModel.addTransforms(s.transforms, model);
+    s.modelBounds = s.ourModel.bounds();
+#endif
+    s.floorTransform = s.transforms.add(glm::mat4(1.0f));
+    // only the spinning block and nothing below it is recomputed
+    if (s.setup == SCENE_BENCHMARK)
+        s.props.setLocal(s.spinningBlock, Scene::spinningBlockLocal(s.frame++));
+    s.props.update();
+    s.blockTransform = s.transforms.size();
+    for (unsigned int i = 0; i < s.blocks.size(); i++)
+        s.transforms.add(s.props.world(s.blocks[i]));
+    s.transforms.update();
+    // bounds and transforms for the compute culling of both views
+    if (s.gpuCulling) {
+        s.addBlockDraws();
+#ifdef OGL_HAS_ASSIMP
+        s.modelCuller.clear();
+        s.ourModel.addDraws(s.modelCuller, s.transforms, s.backpackTransform);
+        s.modelCuller.upload();
+#endif
+    }
+
+    // opaque objects and the sky in key order
+    GLState::stencilMask(0x00);
+    s.cull(projection * view, s.mirrorHiZ);
+    s.queueView(0, camera.Position);
+    s.drawQueue(0);
+    s.retestOccluded(s.fbo.id, width / 2, height / 2, projection * view, s.mirrorHiZ);
+
+    // Grass, weighted blending needs no order
+    if (!s.weightedGrass()) {
+        s.grassOrder.begin(camera.Position, camera.Front);
+        for (unsigned int i = 0; i < s.vegetation.size(); i++)
+            s.grassOrder.add(s.vegetation[i] + s.quadBounds.center());
+        s.grassOrder.sort();
+    }
+    s.drawGrass(s.fbo.id, width / 2, height / 2, s.mirrorOIT);
+
+    // ######################
+    // Second pass to draw normal scene
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(0, 0, width, height);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+    // pass projection matrix to shader
+    projection = glm::perspective(glm::radians(camera.Fov), (float)width / (float)height, NEAR_PLANE, FAR_PLANE);
+    s.frameUniforms.setView(1, projection, view, camera.Position);
+    s.frameUniforms.use(1);
+
+    // opaque objects and the sky in key order
+    GLState::stencilMask(0x00);
+    s.cull(projection * view, s.mainHiZ);
+    s.queueView(1, camera.Position);
+    s.drawQueue(1);
+    s.retestOccluded(targetFBO, width, height, projection * view, s.mainHiZ);
+
+    // Grass
+    s.drawGrass(targetFBO, width, height, s.mainOIT);
+
+    // Final pass to draw render texture to screen quad
+    if (zoom) {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        GLState::enable(GL_DEPTH_TEST, false);
+
+        s.screenShader.use();
+        s.screenVAO.bind();
+        s.bufferTexture.activate(s.screenShader, "screenTexture", 0);
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "camera.h"
+
+// Clipping planes shared by all views
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+struct Scene;
+
+// What the scene holds besides the demo itself
+enum SceneSetup {
+	SCENE_DEMO,			// the backpack, the floor, the vegetation and the sky
+	SCENE_BENCHMARK		// also objects that only exist to exercise the
+						// culling paths, e.g. boxes hidden behind others
+};
+
+// Owns every GL resource of the demo scene and draws one frame of it. The
+// renderer does not know about windows or input, the caller supplies a
+// current GL context (see context.h) and a camera.
+class Renderer
+{
+public:
+	// root is the directory that holds shaders/, textures/ and models/,
+	// width and height are the size of the final render target.
+	Renderer(const std::string& root, unsigned int width, unsigned int height, SceneSetup setup = SCENE_DEMO);
+	~Renderer();
+
+	// Framebuffer that receives the main pass, 0 for the window
+	void setTarget(unsigned int fbo) { targetFBO = fbo; }
+	void resize(unsigned int width, unsigned int height);
+	// Renders the mirror pass into the offscreen FBO followed by the main
+	// pass into the target. zoom shows the mirror texture on a screen quad.
+	void renderFrame(Camera& camera, bool zoom);
+	// Block until every texture has streamed in and every program submitted
+	// at load has compiled, frames rendered before that show placeholders.
+	// The first frame does the rest of it if this was not called.
+	void finishLoading();
+	// Keep quantised model positions and indices in system memory, e.g. for
+	// picking, instead of dropping the geometry once loading is finished.
+	// Call before finishLoading().
+	void setKeepCompressedGeometry(bool enabled);
+	// System memory held by the model, see Model::cpuBytes()
+	size_t geometryBytes() const;
+	// Programs linked and verified so far, and programs the driver is still
+	// compiling. Deferred programs are in neither until their first use.
+	unsigned int programsReady() const;
+	unsigned int programsCompiling() const;
+	// World matrices the scene graphs of the props and the model recomputed
+	// since loading, moving nodes only update their subtree
+	unsigned int updatedNodes() const;
+	// Objects drawn and skipped by frustum culling, over both passes of
+	// every frame since the last reset
+	unsigned int visibleObjects() const;
+	unsigned int culledObjects() const;
+	void resetCullingCounters();
+	// GPU culled draws that occlusion culling hid in the last view drawn.
+	// Reads back from the GPU and waits for it, for statistics only.
+	unsigned int occludedObjects() const;
+	// Draw the vegetation with weighted blended order-independent
+	// transparency instead of sorting it. Needs GL 4.0 or
+	// ARB_draw_buffers_blend, sorting is kept otherwise.
+	void setWeightedTransparency(bool enabled);
+	// Cull the meshes of the model and the glass blocks in a compute shader
+	// that writes their indirect draws, they are then not counted above.
+	// Needs GL 4.3 and ARB_shader_draw_parameters, returns false and keeps
+	// culling on the CPU otherwise.
+	bool setGPUCulling(bool enabled);
+	// Also skip those hidden behind the depth of the previous frame. Returns
+	// false and stays off without GPU culling.
+	bool setOcclusionCulling(bool enabled);
+
+private:
+	std::unique_ptr<Scene> scene;
+	unsigned int width, height;
+	unsigned int targetFBO;
+};
+
+#endif // !RENDERER_H
@@ -0,0 +1,79 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+// Node hierarchy kept as flat arrays indexed by node. Nodes are added
+// parents first, so a single forward pass over the arrays visits every
+// parent before its children. setLocal() only marks a node dirty, update()
+// then recomputes the world matrices of the dirty nodes and everything
+// below them and leaves the rest alone.
+class SceneGraph
+{
+public:
+	static const int NO_PARENT = -1;
+
+	SceneGraph() : updatedCount(0) {}
+
+	// parent has to be added already (or NO_PARENT), returns the node index
+	unsigned int addNode(int parent, const glm::mat4& local)
+	{
+		parents.push_back(parent);
+		locals.push_back(local);
+		worlds.push_back(local);
+		dirty.push_back(1);
+		return parents.size() - 1;
+	}
+	void clear()
+	{
+		parents.clear();
+		locals.clear();
+		worlds.clear();
+		dirty.clear();
+	}
+	unsigned int size() const { return parents.size(); }
+
+	int parent(unsigned int node) const { return parents[node]; }
+	const glm::mat4& local(unsigned int node) const { return locals[node]; }
+	// Valid after update()
+	const glm::mat4& world(unsigned int node) const { return worlds[node]; }
+
+	void setLocal(unsigned int node, const glm::mat4& local)
+	{
+		locals[node] = local;
+		dirty[node] = 1;
+	}
+
+	// Recompute the world matrices of dirty subtrees. A node is recomputed
+	// when it or its parent changed in this pass, which the order of the
+	// arrays makes known by the time the node is reached.
+	void update()
+	{
+		for (unsigned int i = 0; i < parents.size(); i++) {
+			int p = parents[i];
+			if (p != NO_PARENT && dirty[p])
+				dirty[i] = 1;
+			if (!dirty[i])
+				continue;
+			worlds[i] = p == NO_PARENT ? locals[i] : worlds[p] * locals[i];
+			updatedCount++;
+		}
+		// cleared afterwards, children read the flags of their parents
+		for (unsigned int i = 0; i < dirty.size(); i++)
+			dirty[i] = 0;
+	}
+
+	// World matrices recomputed by update() since construction
+	unsigned int updatedNodes() const { return updatedCount; }
+
+private:
+	std::vector<int> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<unsigned char> dirty;
+	unsigned int updatedCount;
+};
+
+#endif // !SCENE_GRAPH_H
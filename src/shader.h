@@ -2,23 +2,102 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+#include "gl_state.h"
+#include "program_cache.h"
+
+// When a Shader compiles its program
+enum ShaderLoad {
+	SHADER_LOAD_NOW,		// compile and link in the constructor
+	SHADER_LOAD_ASYNC,		// submit compile and link, wait for the result at first use
+	SHADER_LOAD_DEFERRED	// only read the sources, compile at first use
+};
+
+// Code of both stages with the #include lines resolved, see
+// Shader::readSource(). Programs that only differ in their defines are
+// built from one copy.
+struct ShaderSource
+{
+	std::string vertexCode;
+	std::string fragmentCode;
+};
+
+enum ShaderState {
+	SHADER_PENDING,			// sources read, nothing submitted yet
+	SHADER_COMPILING,		// compile and link submitted to the driver
+	SHADER_READY,
+	SHADER_FAILED
+};
 
 class Shader
 {
 public:
-	unsigned int ID;		// Program ID
+	unsigned int ID;		// Program ID, 0 until the program is submitted
 
-	Shader(const char* vertexPath, const char* fragmentPath)
+	// defines is pasted below the #version line of both stages, see
+	// ShaderVariants for compiling feature permutations of one program.
+	Shader(const char* vertexPath, const char* fragmentPath, ShaderLoad load = SHADER_LOAD_NOW,
+		const std::string& defines = "") :
+		Shader(readSource(vertexPath, fragmentPath), load, defines) {}
+	// Program from code read earlier
+	Shader(const ShaderSource& source, ShaderLoad load = SHADER_LOAD_NOW, const std::string& defines = "") :
+		ID(0), state(SHADER_PENDING), compute(false), vertexShader(0), fragmentShader(0), cacheKey(0), serialNumber(nextSerial())
 	{
-		// 1. Retrieve shader source code
+		// feature defines
+		vertexCode = defines.empty() ? source.vertexCode : injectDefines(source.vertexCode, defines);
+		fragmentCode = defines.empty() ? source.fragmentCode : injectDefines(source.fragmentCode, defines);
+
+		// 2. Compile shaders
+		if (load != SHADER_LOAD_DEFERRED)
+			submit();
+		if (load == SHADER_LOAD_NOW)
+			finish();
+	};
+
+	// Compute program (GL 4.3, check GLExt.computeShader before use)
+	Shader(const char* computePath, ShaderLoad load, const std::string& defines = "") :
+		ID(0), state(SHADER_PENDING), compute(true), vertexShader(0), fragmentShader(0), cacheKey(0), serialNumber(nextSerial())
+	{
+		std::ifstream cShaderFile;
+		cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+		try
+		{
+			cShaderFile.open(computePath);
+			std::stringstream cShaderStream;
+			cShaderStream << cShaderFile.rdbuf();
+			cShaderFile.close();
+			vertexCode = cShaderStream.str();
+		}
+		catch(const std::ifstream::failure&)
+		{
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+		}
+		vertexCode = resolveIncludes(vertexCode, directoryOf(computePath));
+		if (!defines.empty())
+			vertexCode = injectDefines(vertexCode, defines);
+		if (load != SHADER_LOAD_DEFERRED)
+			submit();
+		if (load == SHADER_LOAD_NOW)
+			finish();
+	}
+
+	// 1. Retrieve shader source code, with #include "file" directives
+	// resolved
+	static ShaderSource readSource(const char* vertexPath, const char* fragmentPath)
+	{
+		ShaderSource source;
 		// initialise
-		std::string vertexCode;
-		std::string fragmentCode;
 		std::ifstream vShaderFile;
 		std::ifstream fShaderFile;
 		// exception enabling
@@ -37,104 +116,377 @@ public:
 			vShaderFile.close();
 			fShaderFile.close();
 			// convert stream into into string
-			vertexCode = vShaderStream.str();
-			fragmentCode = fShaderStream.str();
+			source.vertexCode = vShaderStream.str();
+			source.fragmentCode = fShaderStream.str();
 		}
-		catch(std::ifstream::failure e)
+		catch(const std::ifstream::failure&)
 		{
 			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
 		}
+		source.vertexCode = resolveIncludes(source.vertexCode, directoryOf(vertexPath));
+		source.fragmentCode = resolveIncludes(source.fragmentCode, directoryOf(fragmentPath));
+		return source;
+	}
+
+	// Hand compile and link to the driver without waiting for the result.
+	// With KHR_parallel_shader_compile the driver works on its own threads.
+	void submit()
+	{
+		if (state != SHADER_PENDING)
+			return;
+		state = SHADER_COMPILING;
+		// try the program binary cache first
+		cacheKey = ProgramCache::key(vertexCode, fragmentCode);
+		ID = glCreateProgram();
+		if (ProgramCache::load(ID, cacheKey)) {
+			releaseSources();
+			return;
+		}
 		// convert to const char
 		const char* vShaderCode = vertexCode.c_str();
 		const char* fShaderCode = fragmentCode.c_str();
-
-		// 2. Compile shaders
-		// init
-		unsigned int vertexShader, fragmentShader;
-		// compile and verify vertex shader
-		vertexShader = glCreateShader(GL_VERTEX_SHADER);
+		// compile vertex (or compute) shader
+		vertexShader = glCreateShader(compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER);
 		glShaderSource(vertexShader, 1, &vShaderCode, NULL);
 		glCompileShader(vertexShader);
-		checkCompileErrors(vertexShader, "VERTEX");
-		// compile and verify fragment shader
-		fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
-		glCompileShader(fragmentShader);
-		checkCompileErrors(fragmentShader, "FRAGMENT");
-		// Link and verify shader program
-		ID = glCreateProgram();
+		// compile fragment shader
+		if (!compute) {
+			fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+			glShaderSource(fragmentShader, 1, &fShaderCode, NULL);
+			glCompileShader(fragmentShader);
+		}
+		// Link shader program, status is checked in finish()
 		glAttachShader(ID, vertexShader);
-		glAttachShader(ID, fragmentShader);
+		if (fragmentShader)
+			glAttachShader(ID, fragmentShader);
+		ProgramCache::prepare(ID);
 		glLinkProgram(ID);
-		checkCompileErrors(ID, "PROGRAM");
-		// clean up
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+		releaseSources();
+	}
 
-	};
+	// Whether finish() can run without stalling. Without
+	// KHR_parallel_shader_compile there is no way to tell, so a submitted
+	// program always reports true.
+	bool isCompiled() const
+	{
+		if (state != SHADER_COMPILING)
+			return state != SHADER_PENDING;
+		if (!GLExt.parallelShaderCompile)
+			return true;
+		GLint done = GL_FALSE;
+		glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	// Wait for the program, verify it and fill the uniform cache
+	void finish()
+	{
+		if (state == SHADER_PENDING)
+			submit();
+		if (state != SHADER_COMPILING)
+			return;
+		bool linked;
+		if (vertexShader) {
+			// verify shaders and program
+			checkCompileErrors(vertexShader, compute ? "COMPUTE" : "VERTEX");
+			if (fragmentShader)
+				checkCompileErrors(fragmentShader, "FRAGMENT");
+			linked = checkCompileErrors(ID, "PROGRAM");
+			if (linked)
+				ProgramCache::store(ID, cacheKey);
+			glDetachShader(ID, vertexShader);
+			if (fragmentShader)
+				glDetachShader(ID, fragmentShader);
+			// clean up
+			glDeleteShader(vertexShader);
+			glDeleteShader(fragmentShader);
+			vertexShader = fragmentShader = 0;
+		}
+		else {
+			// restored from the binary cache
+			linked = true;
+		}
+		state = linked ? SHADER_READY : SHADER_FAILED;
+		// cache uniform locations
+		reflectUniforms();
+		for (unsigned int i = 0; i < blockBindings.size(); i++)
+			applyBlockBinding(blockBindings[i].first.c_str(), blockBindings[i].second);
+		blockBindings.clear();
+	}
+	ShaderState status() const { return state; }
+	// Unique among the Shaders of the process, unlike program IDs which the
+	// driver hands out again after a program is deleted
+	uint64_t serial() const { return serialNumber; }
 
 	void use()
 	{
-		glUseProgram(ID);
+		if (state != SHADER_READY && state != SHADER_FAILED)
+			finish();
+		GLState::useProgram(ID);
 	};
+	// Attach the named uniform block to a binding point, GLSL 330 has no
+	// layout(binding = N). Returns false if the program has no such block.
+	// Until the program is finished the binding is queued, querying the
+	// block index would wait for the link.
+	bool bindUniformBlock(const char* name, unsigned int binding)
+	{
+		if (state == SHADER_PENDING || state == SHADER_COMPILING) {
+			blockBindings.push_back(std::make_pair(std::string(name), binding));
+			return true;
+		}
+		return applyBlockBinding(name, binding);
+	}
+	// Returns a handle for the named uniform, -1 if the program has no
+	// such active uniform. Handles stay valid for the program's lifetime.
+	int uniform(const std::string& name) const
+	{
+		std::unordered_map<std::string, int>::const_iterator it = handles.find(name);
+		return it == handles.end() ? -1 : it->second;
+	}
+	// Forget the shadow copies, e.g. after uniforms were set behind our back
+	void invalidateUniforms()
+	{
+		for (unsigned int i = 0; i < uniforms.size(); i++)
+			uniforms[i].valid = false;
+	}
+	// ------------------------------------------------------------------------
+	// Setters by handle, uploads that match the last value are skipped.
+	// The program has to be in use, as with glUniform*.
+	void setBool(int handle, bool value) const
+	{
+		setInt(handle, (int)value);
+	}
+	void setInt(int handle, int value) const
+	{
+		if (changed(handle, &value, sizeof(int)))
+			glUniform1i(uniforms[handle].location, value);
+	}
+	void setFloat(int handle, float value) const
+	{
+		if (changed(handle, &value, sizeof(float)))
+			glUniform1f(uniforms[handle].location, value);
+	}
+	void setVec2(int handle, const glm::vec2& value) const
+	{
+		if (changed(handle, &value[0], sizeof(glm::vec2)))
+			glUniform2fv(uniforms[handle].location, 1, &value[0]);
+	}
+	void setVec3(int handle, const glm::vec3& value) const
+	{
+		if (changed(handle, &value[0], sizeof(glm::vec3)))
+			glUniform3fv(uniforms[handle].location, 1, &value[0]);
+	}
+	void setVec4(int handle, const glm::vec4& value) const
+	{
+		if (changed(handle, &value[0], sizeof(glm::vec4)))
+			glUniform4fv(uniforms[handle].location, 1, &value[0]);
+	}
+	void setMat2(int handle, const glm::mat2& mat) const
+	{
+		if (changed(handle, &mat[0][0], sizeof(glm::mat2)))
+			glUniformMatrix2fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat3(int handle, const glm::mat3& mat) const
+	{
+		if (changed(handle, &mat[0][0], sizeof(glm::mat3)))
+			glUniformMatrix3fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+	void setMat4(int handle, const glm::mat4& mat) const
+	{
+		if (changed(handle, &mat[0][0], sizeof(glm::mat4)))
+			glUniformMatrix4fv(uniforms[handle].location, 1, GL_FALSE, &mat[0][0]);
+	}
+	// ------------------------------------------------------------------------
+	// Setters by name, looked up in the location cache
 	void setBool(const std::string& name, bool value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+		setInt(uniform(name), (int)value);
 	};
 	void setInt(const std::string& name, int value) const
 	{
-		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+		setInt(uniform(name), value);
 	};
 	void setFloat(const std::string& name, float value) const
 	{
-		glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+		setFloat(uniform(name), value);
 	};
 	// ------------------------------------------------------------------------
 	void setVec2(const std::string& name, const glm::vec2& value) const
 	{
-		glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec2(uniform(name), value);
 	}
 	void setVec2(const std::string& name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+		setVec2(uniform(name), glm::vec2(x, y));
 	}
 	// ------------------------------------------------------------------------
 	void setVec3(const std::string& name, const glm::vec3& value) const
 	{
-		glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec3(uniform(name), value);
 	}
 	void setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+		setVec3(uniform(name), glm::vec3(x, y, z));
 	}
 	// ------------------------------------------------------------------------
 	void setVec4(const std::string& name, const glm::vec4& value) const
 	{
-		glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+		setVec4(uniform(name), value);
 	}
 	void setVec4(const std::string& name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+		setVec4(uniform(name), glm::vec4(x, y, z, w));
 	}
 	// ------------------------------------------------------------------------
 	void setMat2(const std::string& name, const glm::mat2& mat) const
 	{
-		glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat2(uniform(name), mat);
 	}
 	// ------------------------------------------------------------------------
 	void setMat3(const std::string& name, const glm::mat3& mat) const
 	{
-		glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat3(uniform(name), mat);
 	}
 	// ------------------------------------------------------------------------
 	void setMat4(const std::string& name, const glm::mat4& mat) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+		setMat4(uniform(name), mat);
 	}
 private:
+	ShaderState state;
+	bool compute;
+	// a compute program keeps its only stage in vertexCode and vertexShader
+	std::string vertexCode, fragmentCode;
+	unsigned int vertexShader, fragmentShader;
+	uint64_t cacheKey;
+	uint64_t serialNumber;
+	std::vector<std::pair<std::string, unsigned int>> blockBindings;
+
+	static uint64_t nextSerial()
+	{
+		static uint64_t next = 0;
+		return ++next;
+	}
+
+	void releaseSources()
+	{
+		std::string().swap(vertexCode);
+		std::string().swap(fragmentCode);
+	}
+	bool applyBlockBinding(const char* name, unsigned int binding) const
+	{
+		GLuint index = glGetUniformBlockIndex(ID, name);
+		if (index == GL_INVALID_INDEX)
+			return false;
+		glUniformBlockBinding(ID, index, binding);
+		return true;
+	}
+
+	// Active uniform with the last value uploaded through this object
+	struct Uniform
+	{
+		GLint location;
+		bool valid;
+		float value[16];
+	};
+	mutable std::vector<Uniform> uniforms;
+	std::unordered_map<std::string, int> handles;
+
+	// Fill the location cache from the linked program. Arrays of basic types
+	// are reported once as "name[0]", every element gets its own handle.
+	void reflectUniforms()
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::vector<GLchar> buffer(maxLength > 0 ? maxLength : 1);
+		for (GLint i = 0; i < count; i++) {
+			GLint size;
+			GLenum type;
+			glGetActiveUniform(ID, i, (GLsizei)buffer.size(), NULL, &size, &type, buffer.data());
+			std::string name = buffer.data();
+			GLint location = glGetUniformLocation(ID, name.c_str());
+			// members of uniform blocks have no location
+			if (location < 0)
+				continue;
+			addUniform(name, location);
+			if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+				std::string base = name.substr(0, name.size() - 3);
+				handles[base] = handles[name];
+				for (GLint j = 1; j < size; j++) {
+					std::string element = base + "[" + std::to_string(j) + "]";
+					addUniform(element, glGetUniformLocation(ID, element.c_str()));
+				}
+			}
+		}
+	}
+	void addUniform(const std::string& name, GLint location)
+	{
+		Uniform u;
+		u.location = location;
+		u.valid = false;
+		handles[name] = (int)uniforms.size();
+		uniforms.push_back(u);
+	}
+	// Compare against the shadow copy and update it. Returns whether the
+	// value has to be uploaded.
+	bool changed(int handle, const void* value, size_t bytes) const
+	{
+		if (handle < 0)
+			return false;
+		Uniform& u = uniforms[handle];
+		if (u.valid && std::memcmp(u.value, value, bytes) == 0)
+			return false;
+		std::memcpy(u.value, value, bytes);
+		u.valid = true;
+		return true;
+	}
+
+	static std::string directoryOf(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+	}
+	// Paste the contents of #include "file" lines (relative to the including
+	// file) into the source. Included files may include others.
+	static std::string resolveIncludes(const std::string& source, const std::string& dir, int depth = 0)
+	{
+		std::stringstream in(source);
+		std::string result, line;
+		while (std::getline(in, line)) {
+			size_t start = line.find_first_not_of(" \t");
+			if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+				size_t open = line.find('"', start);
+				size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+				std::string file = close == std::string::npos ? "" : line.substr(open + 1, close - open - 1);
+				std::ifstream includeFile(dir + "/" + file);
+				if (file.empty() || !includeFile || depth > 16) {
+					std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << line << std::endl;
+					continue;
+				}
+				std::stringstream includeStream;
+				includeStream << includeFile.rdbuf();
+				result += resolveIncludes(includeStream.str(), directoryOf(dir + "/" + file), depth + 1);
+				continue;
+			}
+			result += line + "\n";
+		}
+		return result;
+	}
+
+	// Insert defines after the #version directive, which has to stay first
+	static std::string injectDefines(const std::string& source, const std::string& defines)
+	{
+		size_t version = source.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : source.find('\n', version);
+		if (lineEnd == std::string::npos)
+			return defines + source;
+		return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+	}
+
 	// utility function for checking shader compilation/linking errors.
 	// ------------------------------------------------------------------------
-	void checkCompileErrors(GLuint shader, std::string type)
+	bool checkCompileErrors(GLuint shader, std::string type)
 	{
 		GLint success;
 		GLchar infoLog[1024];
@@ -156,7 +508,45 @@ private:
 				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
 			}
 		}
+	return success == GL_TRUE;
 	}
 };
 
+// Uniform handles a class needs from each program it is used with, looked
+// up once per Shader. Bindings is a struct of handles with a
+// resolve(const Shader&) that fills it. The program of the previous call is
+// found with one compare, draws sorted by program mostly hit that. A
+// program that has not finished compiling has no handles yet, it is
+// resolved again on every call until it has.
+template<typename Bindings>
+class UniformBindings
+{
+public:
+	UniformBindings() : last(NULL), lastSerial(0) {}
+
+	const Bindings& get(const Shader& shader) const
+	{
+		if (last && lastSerial == shader.serial())
+			return *last;
+		if (shader.status() != SHADER_READY && shader.status() != SHADER_FAILED) {
+			pending.resolve(shader);
+			return pending;
+		}
+		lastSerial = shader.serial();
+		typename std::unordered_map<uint64_t, Bindings>::iterator it = programs.find(lastSerial);
+		if (it != programs.end())
+			return *(last = &it->second);
+		Bindings& b = programs[lastSerial];
+		b.resolve(shader);
+		return *(last = &b);
+	}
+	unsigned int size() const { return programs.size(); }
+
+private:
+	mutable std::unordered_map<uint64_t, Bindings> programs;	// by Shader::serial()
+	mutable Bindings pending;
+	mutable const Bindings* last;
+	mutable uint64_t lastSerial;
+};
+
 #endif
\ No newline at end of file
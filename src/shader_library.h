@@ -0,0 +1,99 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glext.h"
+#include "shader.h"
+
+// Named collection of programs. Programs added as SHADER_LOAD_ASYNC are all
+// submitted before any result is waited on, so with
+// KHR_parallel_shader_compile startup is bounded by the slowest program
+// instead of the sum. Rarely used programs can be SHADER_LOAD_DEFERRED and
+// only compile on their first use().
+class ShaderLibrary
+{
+public:
+	ShaderLibrary()
+	{
+		// let the driver use as many compiler threads as it likes
+		if (GLExt.parallelShaderCompile)
+			glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+
+	// Shaders live as long as the library, the reference stays valid
+	Shader& add(const std::string& name, const std::string& vertexPath, const std::string& fragmentPath,
+		ShaderLoad load = SHADER_LOAD_ASYNC, const std::string& defines = "")
+	{
+		programs.push_back(std::unique_ptr<Shader>(new Shader(vertexPath.c_str(), fragmentPath.c_str(), load, defines)));
+		names[name] = programs.size() - 1;
+		return *programs.back();
+	}
+	// Compute programs share the name space and the block bindings
+	Shader& addCompute(const std::string& name, const std::string& computePath,
+		ShaderLoad load = SHADER_LOAD_DEFERRED, const std::string& defines = "")
+	{
+		programs.push_back(std::unique_ptr<Shader>(new Shader(computePath.c_str(), load, defines)));
+		names[name] = programs.size() - 1;
+		return *programs.back();
+	}
+	bool has(const std::string& name) const { return names.find(name) != names.end(); }
+	Shader& get(const std::string& name) { return *programs[names.at(name)]; }
+
+	// Queue a uniform block binding on every program
+	void bindUniformBlock(const char* name, unsigned int binding)
+	{
+		for (unsigned int i = 0; i < programs.size(); i++)
+			programs[i]->bindUniformBlock(name, binding);
+	}
+
+	// Finish the programs whose compile completed without blocking. Returns
+	// the number of submitted programs still compiling.
+	unsigned int poll()
+	{
+		unsigned int compiling = 0;
+		for (unsigned int i = 0; i < programs.size(); i++) {
+			Shader& shader = *programs[i];
+			if (shader.status() != SHADER_COMPILING)
+				continue;
+			if (GLExt.parallelShaderCompile && !shader.isCompiled())
+				compiling++;
+			else
+				shader.finish();
+		}
+		return compiling;
+	}
+	// Wait for every submitted program, deferred ones are left alone
+	void finishAll()
+	{
+		for (unsigned int i = 0; i < programs.size(); i++)
+			if (programs[i]->status() == SHADER_COMPILING)
+				programs[i]->finish();
+	}
+	// Programs by state, for load statistics
+	unsigned int count(ShaderState state) const
+	{
+		unsigned int n = 0;
+		for (unsigned int i = 0; i < programs.size(); i++)
+			n += programs[i]->status() == state;
+		return n;
+	}
+
+	void Delete()
+	{
+		for (unsigned int i = 0; i < programs.size(); i++)
+			if (programs[i]->ID)
+				GLState::deleteProgram(programs[i]->ID);
+		programs.clear();
+		names.clear();
+	}
+
+private:
+	std::vector<std::unique_ptr<Shader>> programs;
+	std::unordered_map<std::string, unsigned int> names;
+};
+
+#endif // !SHADER_LIBRARY_H
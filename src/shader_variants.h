@@ -0,0 +1,112 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "shader.h"
+
+// Compile time features of a program, each one becomes a #define. Light
+// counts of -1 leave the loop bound to the counts in the Lights block, a
+// fixed count lets the compiler unroll the loop and drop empty light types
+// (NR_SPOT_LIGHTS 0 removes the spot light code entirely).
+struct ShaderFeatures
+{
+	int dirLights = -1;
+	int pointLights = -1;
+	int spotLights = -1;
+	bool specularMap = true;
+	bool instanced = false;
+
+	// Fixed counts up to this many lights per type, dynamic above it, so the
+	// number of variants stays small.
+	static const int MAX_FIXED_LIGHTS = 8;
+
+	void setLightCounts(const glm::uvec3& counts)
+	{
+		dirLights = fixedCount(counts.x);
+		pointLights = fixedCount(counts.y);
+		spotLights = fixedCount(counts.z);
+	}
+
+	// 8 bits per light count (0xff for dynamic) and one bit per flag
+	uint32_t key() const
+	{
+		return (uint32_t)(dirLights & 0xff) | (uint32_t)(pointLights & 0xff) << 8 | (uint32_t)(spotLights & 0xff) << 16 |
+			(uint32_t)specularMap << 24 | (uint32_t)instanced << 25;
+	}
+
+	std::string defines() const
+	{
+		std::string result;
+		if (dirLights >= 0)
+			result += "#define NR_DIR_LIGHTS " + std::to_string(dirLights) + "\n";
+		if (pointLights >= 0)
+			result += "#define NR_POINT_LIGHTS " + std::to_string(pointLights) + "\n";
+		if (spotLights >= 0)
+			result += "#define NR_SPOT_LIGHTS " + std::to_string(spotLights) + "\n";
+		if (specularMap)
+			result += "#define HAS_SPECULAR_MAP\n";
+		if (instanced)
+			result += "#define INSTANCED\n";
+		return result;
+	}
+
+private:
+	static int fixedCount(unsigned int count) { return count <= (unsigned int)MAX_FIXED_LIGHTS ? (int)count : -1; }
+};
+
+// Lazily compiled permutations of one vertex/fragment pair. The sources are
+// read once, get() compiles a variant the first time its features are asked
+// for and returns the cached program after that.
+class ShaderVariants
+{
+public:
+	ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, ShaderLoad load = SHADER_LOAD_NOW) :
+		source(Shader::readSource(vertexPath.c_str(), fragmentPath.c_str())), load(load) {}
+
+	Shader& get(const ShaderFeatures& features)
+	{
+		uint32_t key = features.key();
+		std::unordered_map<uint32_t, std::unique_ptr<Shader>>::iterator it = variants.find(key);
+		if (it != variants.end())
+			return *it->second;
+		Shader* shader = new Shader(source, load, features.defines());
+		for (unsigned int i = 0; i < blockBindings.size(); i++)
+			shader->bindUniformBlock(blockBindings[i].first.c_str(), blockBindings[i].second);
+		variants[key] = std::unique_ptr<Shader>(shader);
+		return *shader;
+	}
+
+	// Applied to the variants compiled so far and to every later one
+	void bindUniformBlock(const char* name, unsigned int binding)
+	{
+		blockBindings.push_back(std::make_pair(std::string(name), binding));
+		for (std::unordered_map<uint32_t, std::unique_ptr<Shader>>::iterator it = variants.begin(); it != variants.end(); it++)
+			it->second->bindUniformBlock(name, binding);
+	}
+
+	unsigned int size() const { return variants.size(); }
+
+	void Delete()
+	{
+		for (std::unordered_map<uint32_t, std::unique_ptr<Shader>>::iterator it = variants.begin(); it != variants.end(); it++)
+			if (it->second->ID)
+				GLState::deleteProgram(it->second->ID);
+		variants.clear();
+	}
+
+private:
+	ShaderSource source;
+	ShaderLoad load;
+	std::vector<std::pair<std::string, unsigned int>> blockBindings;
+	std::unordered_map<uint32_t, std::unique_ptr<Shader>> variants;
+};
+
+#endif // !SHADER_VARIANTS_H
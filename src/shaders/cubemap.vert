@@ -3,11 +3,11 @@ layout (location = 0) in vec3 aPos;
 
 out vec3 textureDir;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "frame.glsl"
 
 void main()
 {
     textureDir = aPos;
-    gl_Position = (projection * view * vec4(aPos, 1.0)).xyww;
+    // drop the translation so the box stays around the camera
+    gl_Position = (projection * mat4(mat3(view)) * vec4(aPos, 1.0)).xyww;
 }  
\ No newline at end of file
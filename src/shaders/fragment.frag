@@ -3,134 +3,135 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 FragPos;
 in vec2 texCoord;
+#ifdef INSTANCED
+in vec4 Tint;
+#endif
 //in vec3 ourColor;
 
 
 //uniform sampler2D ourTexture1;
 //uniform sampler2D ourTexture2;
 
+// Feature defines injected by ShaderVariants (shader_variants.h):
+//   NR_DIR_LIGHTS, NR_POINT_LIGHTS, NR_SPOT_LIGHTS  fixed light counts, the
+//       counts from the Lights block are used when they are not defined
+//   HAS_SPECULAR_MAP  sample texture_specular1, otherwise the diffuse
+//       sample doubles as specular colour
+//   INSTANCED         per instance transform and tint (instances.h)
+
 struct Material{
     sampler2D texture_diffuse1;
+#ifdef HAS_SPECULAR_MAP
     sampler2D texture_specular1;
+#endif
     float shininess;
 };
 
-struct DirLight{
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-struct PointLight{
-    vec3 position;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct SpotLight{
-    vec3 position;
-    vec3 direction;
-
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-
-    float cutOff;
-    float outerCutOff; 
+uniform Material material;
 
-    float constant;
-    float linear;
-    float quadratic;
-};
+#include "frame.glsl"
+#include "lights.glsl"
 
-#define NR_POINT_LIGHTS 4 
-uniform Material material;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform vec3 viewPos;
+#ifndef NR_DIR_LIGHTS
+#define NR_DIR_LIGHTS lightCounts.x
+#endif
+#ifndef NR_POINT_LIGHTS
+#define NR_POINT_LIGHTS lightCounts.y
+#endif
+#ifndef NR_SPOT_LIGHTS
+#define NR_SPOT_LIGHTS lightCounts.z
+#endif
 
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 viewDir);
+vec3 CalcDirLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+vec3 CalcPointLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
+vec3 CalcSpotLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor);
 
 void main()
 {
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
-    // Directional light
-    vec3 result = CalcDirLight(dirLight, norm, viewDir);
-    // Point light
+    // sample the material once for all lights
+    vec4 diffuseSample = texture(material.texture_diffuse1, texCoord);
+#ifdef INSTANCED
+    diffuseSample *= Tint;
+#endif
+    vec3 diffuseColor = diffuseSample.rgb;
+#ifdef HAS_SPECULAR_MAP
+    vec3 specularColor = texture(material.texture_specular1, texCoord).rgb;
+#else
+    vec3 specularColor = diffuseColor;
+#endif
+    vec3 result = vec3(0.0);
+    int first = 0;
+    // Directional lights
+    for(int i = 0; i < NR_DIR_LIGHTS; i++)
+        result += CalcDirLight(lights[first + i], norm, viewDir, diffuseColor, specularColor);
+    first += NR_DIR_LIGHTS;
+    // Point lights
     for(int i = 0; i < NR_POINT_LIGHTS; i++)
-        result += CalcPointLight(pointLights[i], norm, viewDir);
-    // Spot light
-    result += CalcSpotLight(spotLight, norm, viewDir);
+        result += CalcPointLight(lights[first + i], norm, viewDir, diffuseColor, specularColor);
+    first += NR_POINT_LIGHTS;
+    // Spot lights
+    for(int i = 0; i < NR_SPOT_LIGHTS; i++)
+        result += CalcSpotLight(lights[first + i], norm, viewDir, diffuseColor, specularColor);
     FragColor = vec4(result, 1.0);
 }
 
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir){
+vec3 CalcDirLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor){
     // light direction
-    vec3 lightDir = normalize(-light.direction);
+    vec3 lightDir = normalize(-light.direction.xyz);
     // ambient
-    vec3 ambient = light.ambient * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 ambient = light.ambient.rgb * diffuseColor;
     // diffuse
     float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = light.diffuse * diff * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 diffuse = light.diffuse.rgb * diff * diffuseColor;
     // specular
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * spec * texture(material.texture_specular1, texCoord).rgb;
+    vec3 specular = light.specular.rgb * spec * specularColor;
     // total
     return ambient + diffuse + specular;
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 viewDir){
+vec3 CalcPointLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor){
     // light direction
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(light.position.xyz - FragPos);
     // attentunation
-    float dist          = length(light.position - FragPos);
-    float attentunation = 1.0 / (light.constant + light.linear * dist + light.quadratic * dist * dist);
+    float dist          = length(light.position.xyz - FragPos);
+    float attentunation = 1.0 / (light.attenuation.x + light.attenuation.y * dist + light.attenuation.z * dist * dist);
     // ambient
-    vec3 ambient = light.ambient * attentunation * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 ambient = light.ambient.rgb * attentunation * diffuseColor;
     // diffuse
     float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = light.diffuse * attentunation * diff * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 diffuse = light.diffuse.rgb * attentunation * diff * diffuseColor;
     // specular
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * attentunation * spec * texture(material.texture_specular1, texCoord).rgb;
+    vec3 specular = light.specular.rgb * attentunation * spec * specularColor;
     // total
     return ambient + diffuse + specular;
 }
 
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 viewDir){
+vec3 CalcSpotLight(Light light, vec3 normal, vec3 viewDir, vec3 diffuseColor, vec3 specularColor){
     // light direction
-    vec3 lightDir = normalize(light.position - FragPos);
+    vec3 lightDir = normalize(light.position.xyz - FragPos);
     // distance attentunation
-    float dist          = length(light.position - FragPos);
-    float attentunation = 1.0 / (light.constant + light.linear * dist + light.quadratic * dist * dist);
+    float dist          = length(light.position.xyz - FragPos);
+    float attentunation = 1.0 / (light.attenuation.x + light.attenuation.y * dist + light.attenuation.z * dist * dist);
     // spot intensity
-    float theta = dot(lightDir, normalize(-light.direction));
-    float epsilon   = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+    float theta = dot(lightDir, normalize(-light.direction.xyz));
+    float epsilon   = light.cone.x - light.cone.y;
+    float intensity = clamp((theta - light.cone.y) / epsilon, 0.0, 1.0);
     // ambient
-    vec3 ambient = light.ambient * attentunation * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 ambient = light.ambient.rgb * attentunation * diffuseColor;
     // diffuse
     float diff = max(dot(lightDir, normal), 0.0);
-    vec3 diffuse = light.diffuse * attentunation * intensity * diff * texture(material.texture_diffuse1, texCoord).rgb;
+    vec3 diffuse = light.diffuse.rgb * attentunation * intensity * diff * diffuseColor;
     // specular
     vec3 reflectDir = reflect(-lightDir, normal);
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    vec3 specular = light.specular * attentunation * intensity * spec * texture(material.texture_specular1, texCoord).rgb;
+    vec3 specular = light.specular.rgb * attentunation * intensity * spec * specularColor;
     // total
     return ambient + diffuse + specular;
 }
\ No newline at end of file
@@ -0,0 +1,7 @@
+// Camera constants of the current view, see frame.h
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+};
@@ -0,0 +1,25 @@
+#version 330 core
+// One level of the depth pyramid: the farthest depth of the source texels
+// under this one, see hiz.h
+out float Depth;
+
+uniform sampler2D source;   // only the level to read is enabled
+uniform vec2 sourceSize;    // in texels
+
+void main()
+{
+    ivec2 size = ivec2(sourceSize);
+    ivec2 first = ivec2(gl_FragCoord.xy) * 2;
+    ivec2 last = first + 1;
+    // odd sizes, the last texel also covers the row or column left over
+    if (first.x + 3 == size.x)
+        last.x++;
+    if (first.y + 3 == size.y)
+        last.y++;
+    float depth = 0.0;
+    for (int y = first.y; y <= last.y; y++) {
+        for (int x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, min(ivec2(x, y), size - 1), 0).r);
+    }
+    Depth = depth;
+}
@@ -0,0 +1,34 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec2 texCoord;
+out vec3 Normal;
+out vec3 FragPos;
+
+#include "frame.glsl"
+
+// Per draw data of a multi draw, see Model::DrawPackedRun
+struct DrawData
+{
+    mat4 model;
+    mat3 normalMatrix;    // transpose(inverse(mat3(model))), computed on the CPU
+    uint material;
+};
+layout (std430, binding = 0) readonly buffer Draws
+{
+    DrawData draws[];
+};
+// gl_DrawID restarts at 0 with every call, this is the first draw of the call
+uniform int drawOffset;
+
+void main()
+{
+    DrawData draw = draws[drawOffset + gl_DrawIDARB];
+    FragPos = vec3(draw.model * vec4(aPos, 1.0));
+    Normal = draw.normalMatrix * aNormal;
+    texCoord = aTexCoord;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,19 @@
+// Scene lights, see lights.h. Lights are grouped by type: directional
+// lights first, then point lights, then spot lights.
+#define MAX_LIGHTS 128
+
+struct Light{
+    vec4 position;      // xyz position
+    vec4 direction;     // xyz direction
+    vec4 ambient;
+    vec4 diffuse;
+    vec4 specular;
+    vec4 attenuation;   // constant, linear, quadratic
+    vec4 cone;          // cos(cutOff), cos(outerCutOff)
+};
+
+layout (std140) uniform Lights
+{
+    ivec4 lightCounts;  // directional, point, spot
+    Light lights[MAX_LIGHTS];
+};
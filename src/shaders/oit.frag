@@ -0,0 +1,28 @@
+#version 330 core
+// Accumulation pass of weighted blended order-independent transparency
+// (McGuire and Bavoil 2013). Blended with ONE, ONE into accum and with
+// ZERO, ONE_MINUS_SRC_COLOR into revealage, see oit.h.
+layout (location = 0) out vec4 accum;
+layout (location = 1) out float revealage;
+
+in vec2 TexCoords;
+#ifdef INSTANCED
+in vec4 Tint;
+#endif
+
+uniform sampler2D texture_diffuse1;
+
+void main()
+{
+    vec4 color = texture(texture_diffuse1, TexCoords);
+#ifdef INSTANCED
+    color *= Tint;
+#endif
+    if (color.a < 0.01)
+        discard;
+    // near and opaque fragments weigh more
+    float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 *
+        pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    accum = vec4(color.rgb * color.a, color.a) * weight;
+    revealage = color.a;
+}
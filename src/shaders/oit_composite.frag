@@ -0,0 +1,18 @@
+#version 330 core
+// Resolve of the accumulation targets over the opaque image, blended with
+// ONE_MINUS_SRC_ALPHA, SRC_ALPHA
+out vec4 FragColor;
+
+uniform sampler2D accumTexture;
+uniform sampler2D revealageTexture;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(revealageTexture, coord, 0).r;
+    // nothing transparent covers this pixel
+    if (revealage >= 1.0)
+        discard;
+    vec4 accum = texelFetch(accumTexture, coord, 0);
+    FragColor = vec4(accum.rgb / max(accum.a, 1e-5), revealage);
+}
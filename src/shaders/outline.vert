@@ -9,9 +9,10 @@ out vec2 texCoord;
 out vec3 Normal;
 out vec3 FragPos;
 
+#include "frame.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;    // transpose(inverse(mat3(model))), computed on the CPU
 
 uniform float outlineScale;
 
@@ -20,7 +21,7 @@ void main()
     vec3 scaledPos = aPos + outlineScale * aNormal;
 	gl_Position = projection * view * model * vec4(scaledPos, 1.0);
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
     //ourColor = aColor; // set ourColor to the input color we got from the vertex data
     texCoord = aTexCoord;
 }
\ No newline at end of file
@@ -4,7 +4,8 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 texCoords;
 
-uniform vec3 viewPos;
+#include "frame.glsl"
+
 uniform samplerCube skybox;
 
 void main()
@@ -2,12 +2,18 @@
 out vec4 FragColor;
 
 in vec2 TexCoords;
+#ifdef INSTANCED
+in vec4 Tint;
+#endif
 
 uniform sampler2D texture_diffuse1;
 
 void main()
 {    
     vec4 texColor = texture(texture_diffuse1, TexCoords);
+#ifdef INSTANCED
+    texColor *= Tint;
+#endif
     if (texColor.a < 0.01)
         discard;
     FragColor = texColor;
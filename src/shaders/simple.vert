@@ -4,13 +4,24 @@ layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
 out vec2 TexCoords;
+#ifdef INSTANCED
+// per instance, see instances.h
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in vec4 aInstanceTint;
+out vec4 Tint;
+#endif
+
+#include "frame.glsl"
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 void main()
 {
     TexCoords = aTexCoords;    
+#ifdef INSTANCED
+    gl_Position = projection * view * aInstanceModel * model * vec4(aPos, 1.0);
+    Tint = aInstanceTint;
+#else
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+#endif
 }
\ No newline at end of file
@@ -3,20 +3,35 @@ layout (location = 0) in vec3 aPos;   // the position variable has attribute pos
 layout (location = 1) in vec3 aNormal; // the normal variable has attribute position 1
 layout (location = 2) in vec2 aTexCoord; // texture coordinates have attribute position 2
 //layout (location = 3) in vec3 aColor; // the color variable has attribute position 3
+#ifdef INSTANCED
+// per instance, see instances.h
+layout (location = 3) in mat4 aInstanceModel;
+layout (location = 7) in vec4 aInstanceTint;
+out vec4 Tint;
+#endif
 
 //out vec3 ourColor; // output a color to the fragment shader
 out vec2 texCoord;
 out vec3 Normal;
 out vec3 FragPos;
 
+#include "frame.glsl"
+
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform mat3 normalMatrix;    // transpose(inverse(mat3(model))), computed on the CPU
 
 void main()
 {
+#ifdef INSTANCED
+    // instances are placed with rotation and uniform scale only, so their
+    // upper 3x3 transforms normals as well
+    FragPos = vec3(aInstanceModel * model * vec4(aPos, 1.0));
+    Normal = mat3(aInstanceModel) * (normalMatrix * aNormal);
+    Tint = aInstanceTint;
+#else
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
+#endif
     //ourColor = aColor; // set ourColor to the input color we got from the vertex data
     texCoord = aTexCoord;
     gl_Position = projection * view * vec4(FragPos, 1.0);
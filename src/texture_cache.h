@@ -0,0 +1,136 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "texture_loader.h"
+
+// Process wide registry of file textures. Requests for the same file with
+// the same sampler setup share one GL texture, whichever model or Texture
+// asks for it. Entries are weak: the texture is deleted when the last
+// handle goes away and the next request loads it again.
+//
+// Files are identified by canonical path. With content hashing enabled,
+// byte-identical files under different paths are shared as well, at the
+// cost of reading each file once more on the calling thread.
+class TextureCache
+{
+public:
+	TextureCache() : contentHashing(false), hitCount(0), missCount(0) {}
+
+	static TextureCache& shared()
+	{
+		static TextureCache cache;
+		return cache;
+	}
+
+	void setContentHashing(bool enabled) { contentHashing = enabled; }
+
+	TextureHandle get(const std::string& path, const TextureParams& params = TextureParams())
+	{
+		std::string key = canonical(path) + samplerKey(params);
+		TextureHandle handle = find(byPath, key);
+		std::string contentKey;
+		if (!handle && contentHashing) {
+			contentKey = contentHash(path) + samplerKey(params);
+			handle = find(byContent, contentKey);
+			if (handle)
+				byPath[key] = handle;
+		}
+		if (handle) {
+			hitCount++;
+			return handle;
+		}
+		missCount++;
+		handle = TextureLoader::shared().load(path, params);
+		byPath[key] = handle;
+		if (!contentKey.empty())
+			byContent[contentKey] = handle;
+		return handle;
+	}
+
+	// Forget entries whose texture was released
+	void purge()
+	{
+		purge(byPath);
+		purge(byContent);
+	}
+
+	// Textures currently alive through the cache
+	unsigned int size()
+	{
+		purge();
+		return byPath.size();
+	}
+	unsigned int hits() const { return hitCount; }
+	unsigned int misses() const { return missCount; }
+
+private:
+	typedef std::unordered_map<std::string, std::weak_ptr<AsyncTexture>> Entries;
+
+	Entries byPath;
+	Entries byContent;
+	bool contentHashing;
+	unsigned int hitCount, missCount;
+
+	static TextureHandle find(Entries& entries, const std::string& key)
+	{
+		Entries::iterator it = entries.find(key);
+		if (it == entries.end())
+			return TextureHandle();
+		TextureHandle handle = it->second.lock();
+		if (!handle)
+			entries.erase(it);
+		return handle;
+	}
+	static void purge(Entries& entries)
+	{
+		for (Entries::iterator it = entries.begin(); it != entries.end();) {
+			if (it->second.expired())
+				it = entries.erase(it);
+			else
+				++it;
+		}
+	}
+
+	static std::string canonical(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path result = std::filesystem::weakly_canonical(path, error);
+		return error ? path : result.generic_string();
+	}
+	// Everything in TextureParams changes the GL texture
+	static std::string samplerKey(const TextureParams& params)
+	{
+		char key[64];
+		std::snprintf(key, sizeof(key), "|%x,%x,%x,%x,%d", params.wrapS, params.wrapT,
+			params.minFilter, params.magFilter, params.flip ? 1 : 0);
+		return key;
+	}
+	// FNV-1a over the file, unreadable files fall back to their path
+	static std::string contentHash(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return "path:" + canonical(path);
+		uint64_t hash = 14695981039346656037ull;
+		char buffer[65536];
+		while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0) {
+			for (std::streamsize i = 0; i < file.gcount(); i++) {
+				hash ^= (unsigned char)buffer[i];
+				hash *= 1099511628211ull;
+			}
+		}
+		char key[32];
+		std::snprintf(key, sizeof(key), "content:%016llx", (unsigned long long)hash);
+		return key;
+	}
+};
+
+#endif // !TEXTURE_CACHE_H
@@ -0,0 +1,239 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glext.h"
+#include "gl_state.h"
+#include "thread_pool.h"
+
+// Sampler setup and orientation of a texture loaded from a file
+struct TextureParams
+{
+	GLint wrapS = GL_REPEAT;
+	GLint wrapT = GL_REPEAT;
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR;
+	GLint magFilter = GL_LINEAR;
+	bool flip = true;	// first row at the bottom, as GL expects
+};
+
+// A texture that may still be streaming in. Until it is resident id names
+// a shared 1x1 placeholder, so read id when binding rather than keeping it.
+// The GL texture is deleted with the last handle, on the thread dropping it.
+struct AsyncTexture
+{
+	unsigned int id = 0;
+	bool resident = false;
+	int width = 0;
+	int height = 0;
+};
+typedef std::shared_ptr<AsyncTexture> TextureHandle;
+
+// Decodes image files on the shared thread pool and turns them into
+// immutable textures on the GL thread. load() returns at once; update()
+// uploads whatever finished decoding, staged through a pixel unpack buffer.
+class TextureLoader
+{
+public:
+	TextureLoader() : placeholder(0), pbo(0), inFlight(0) {}
+
+	static TextureLoader& shared()
+	{
+		static TextureLoader loader;
+		return loader;
+	}
+
+	// Wrap a texture that was created directly (render targets)
+	static TextureHandle wrap(unsigned int id, int width, int height)
+	{
+		TextureHandle handle(new AsyncTexture(), release);
+		handle->id = id;
+		handle->resident = true;
+		handle->width = width;
+		handle->height = height;
+		return handle;
+	}
+
+	TextureHandle load(const std::string& path, const TextureParams& params = TextureParams())
+	{
+		TextureHandle handle(new AsyncTexture(), release);
+		handle->id = placeholderTexture();
+		inFlight++;
+		ThreadPool::shared().submit([this, handle, path, params]() {
+			Decoded image;
+			image.handle = handle;
+			image.params = params;
+			image.path = path;
+			stbi_set_flip_vertically_on_load_thread(params.flip);
+			image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(image);
+			}
+			ready.notify_one();
+		});
+		return handle;
+	}
+
+	// Upload decoded images, at most maxUploads of them (0 for all) so a
+	// frame does not stall on a large batch. Returns the loads still pending.
+	unsigned int update(unsigned int maxUploads = 0)
+	{
+		std::vector<Decoded> batch;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			unsigned int n = maxUploads == 0 || maxUploads > decoded.size() ? decoded.size() : maxUploads;
+			batch.assign(decoded.begin(), decoded.begin() + n);
+			decoded.erase(decoded.begin(), decoded.begin() + n);
+		}
+		for (unsigned int i = 0; i < batch.size(); i++) {
+			upload(batch[i]);
+			inFlight--;
+		}
+		return inFlight;
+	}
+
+	// Block until every load so far is resident
+	void finish()
+	{
+		while (inFlight > 0) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				ready.wait(lock, [this]() { return !decoded.empty(); });
+			}
+			update();
+		}
+	}
+
+	unsigned int pending() const { return inFlight; }
+
+	void Delete()
+	{
+		finish();
+		if (placeholder)
+			GLState::deleteTexture(placeholder);
+		if (pbo)
+			glDeleteBuffers(1, &pbo);
+		placeholder = 0;
+		pbo = 0;
+	}
+
+private:
+	struct Decoded
+	{
+		TextureHandle handle;
+		TextureParams params;
+		std::string path;
+		unsigned char* pixels;
+		int width, height, channels;
+	};
+
+	unsigned int placeholder;
+	unsigned int pbo;
+	unsigned int inFlight;		// only touched on the GL thread
+	std::vector<Decoded> decoded;
+	std::mutex mutex;
+	std::condition_variable ready;
+
+	static void release(AsyncTexture* texture)
+	{
+		if (texture->resident)
+			GLState::deleteTexture(texture->id);
+		delete texture;
+	}
+
+	unsigned int placeholderTexture()
+	{
+		if (!placeholder) {
+			const unsigned char grey[4] = { 128, 128, 128, 255 };
+			glGenTextures(1, &placeholder);
+			GLState::bindTexture(GL_TEXTURE_2D, placeholder);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		return placeholder;
+	}
+
+	void upload(Decoded& image)
+	{
+		if (!image.pixels) {
+			std::cout << "Texture failed to load at path: " << image.path << std::endl;
+			return;
+		}
+		GLenum format, internalFormat;
+		if (image.channels == 1) {
+			format = GL_RED;
+			internalFormat = GL_R8;
+		}
+		else if (image.channels == 2) {
+			format = GL_RG;
+			internalFormat = GL_RG8;
+		}
+		else if (image.channels == 3) {
+			format = GL_RGB;
+			internalFormat = GL_RGB8;
+		}
+		else {
+			format = GL_RGBA;
+			internalFormat = GL_RGBA8;
+		}
+		int levels = 1;
+		for (int size = image.width > image.height ? image.width : image.height; size > 1; size >>= 1)
+			levels++;
+
+		unsigned int id;
+		glGenTextures(1, &id);
+		GLState::bindTexture(GL_TEXTURE_2D, id);
+		if (GLExt.textureStorage)
+			glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+		else
+			glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, image.params.wrapS);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, image.params.wrapT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.params.minFilter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, image.params.magFilter);
+
+		// stage through the unpack buffer, orphaned so an upload still in
+		// flight is never waited on
+		GLsizeiptr size = (GLsizeiptr)image.width * image.height * image.channels;
+		if (!pbo)
+			glGenBuffers(1, &pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+		void* staging = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		const void* source = NULL;	// offset into the bound buffer
+		if (staging) {
+			std::memcpy(staging, image.pixels, size);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+		}
+		else {
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			source = image.pixels;
+		}
+		// rows of 1 and 3 channel images are not 4 byte aligned
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, source);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		if (levels > 1)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		stbi_image_free(image.pixels);
+
+		image.handle->id = id;
+		image.handle->width = image.width;
+		image.handle->height = image.height;
+		image.handle->resident = true;
+	}
+};
+
+#endif // !TEXTURE_LOADER_H
@@ -0,0 +1,135 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for CPU work that does not touch GL (asset
+// decoding and conversion). GL calls stay on the context thread.
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int threads = std::max(1u, std::thread::hardware_concurrency())) : stopping(false)
+	{
+		for (unsigned int i = 0; i < threads; i++)
+			workers.push_back(std::thread(&ThreadPool::run, this));
+	}
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Pool shared by the loaders, created on first use
+	static ThreadPool& shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+
+	unsigned int size() const { return workers.size(); }
+
+	// Run task on a worker, the future holds its result
+	template <typename F>
+	std::future<typename std::invoke_result<F>::type> submit(F task)
+	{
+		typedef typename std::invoke_result<F>::type Result;
+		std::shared_ptr<std::packaged_task<Result()>> job(new std::packaged_task<Result()>(task));
+		std::future<Result> result = job->get_future();
+		push([job]() { (*job)(); });
+		return result;
+	}
+
+	// Call body(i) for every i in [0, count) and wait for all of them. The
+	// calling thread works along, so this also makes progress when every
+	// worker is busy with something else.
+	void parallelFor(unsigned int count, const std::function<void(unsigned int)>& body)
+	{
+		if (count == 0)
+			return;
+		// shared so helpers that only start after the loop is done are safe
+		std::shared_ptr<ForState> state(new ForState(count, body));
+		unsigned int helpers = std::min(count - 1, (unsigned int)workers.size());
+		for (unsigned int i = 0; i < helpers; i++)
+			push([state]() { state->work(); });
+		state->work();
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&state]() { return state->done == state->count; });
+	}
+
+private:
+	struct ForState
+	{
+		ForState(unsigned int count, const std::function<void(unsigned int)>& body) :
+			count(count), body(body), next(0), done(0) {}
+
+		const unsigned int count;
+		const std::function<void(unsigned int)> body;
+		std::atomic<unsigned int> next;
+		unsigned int done;
+		std::mutex mutex;
+		std::condition_variable finished;
+
+		void work()
+		{
+			unsigned int completed = 0;
+			for (unsigned int i = next++; i < count; i = next++) {
+				body(i);
+				completed++;
+			}
+			if (completed == 0)
+				return;
+			std::lock_guard<std::mutex> lock(mutex);
+			done += completed;
+			if (done == count)
+				finished.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	void push(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			tasks.push_back(std::move(task));
+		}
+		wake.notify_one();
+	}
+	void run()
+	{
+		for (;;) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return stopping || !tasks.empty(); });
+				if (stopping && tasks.empty())
+					return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,136 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define OGL_TRANSFORMS_SSE
+#endif
+
+#include "shader.h"
+
+// Model matrices of the objects drawn in a frame together with their normal
+// matrices, so the vertex shaders get a ready mat3 instead of running
+// transpose(inverse(model)) per vertex. Objects with a uniform scale use
+// mat3(model) as is, the fragment shaders normalize the normal anyway. The
+// rest is inverted in one pass by update(), four matrices at a time with SSE.
+// The uniform handles are looked up once per program, see UniformBindings.
+class TransformBatch
+{
+public:
+	// Handles of the transform uniforms in one program, -1 where unused
+	struct Bindings
+	{
+		int model, normal;
+
+		void resolve(const Shader& shader)
+		{
+			model = shader.uniform("model");
+			normal = shader.uniform("normalMatrix");
+		}
+	};
+
+	// Returns the index used with apply(). Call update() before drawing.
+	unsigned int add(const glm::mat4& model)
+	{
+		models.push_back(model);
+		normals.push_back(glm::mat3(model));
+		if (!hasUniformScale(model))
+			pending.push_back(models.size() - 1);
+		return models.size() - 1;
+	}
+	void clear()
+	{
+		models.clear();
+		normals.clear();
+		pending.clear();
+	}
+	unsigned int size() const { return models.size(); }
+
+	const glm::mat4& model(unsigned int i) const { return models[i]; }
+	const glm::mat3& normal(unsigned int i) const { return normals[i]; }
+
+	// Compute the normal matrices of everything added since the last update
+	void update()
+	{
+		unsigned int i = 0;
+#ifdef OGL_TRANSFORMS_SSE
+		// the last group repeats its final object to fill the four lanes
+		for (; i < pending.size(); i += 4) {
+			unsigned int group[4];
+			for (unsigned int k = 0; k < 4; k++)
+				group[k] = pending[std::min<size_t>(i + k, pending.size() - 1)];
+			inverseTranspose4(group);
+		}
+#endif
+		for (; i < pending.size(); i++)
+			normals[pending[i]] = glm::transpose(glm::inverse(glm::mat3(models[pending[i]])));
+		pending.clear();
+	}
+
+	// Set the model and normalMatrix uniforms of object i
+	void apply(const Shader& shader, unsigned int i) const
+	{
+		const Bindings& b = bindings(shader);
+		shader.setMat4(b.model, models[i]);
+		shader.setMat3(b.normal, normals[i]);
+	}
+
+	const Bindings& bindings(const Shader& shader) const { return programs.get(shader); }
+
+	// Orthogonal axes of equal length, rotation and uniform scale only
+	static bool hasUniformScale(const glm::mat4& model)
+	{
+		glm::vec3 x = glm::vec3(model[0]), y = glm::vec3(model[1]), z = glm::vec3(model[2]);
+		float lengthSq = glm::dot(x, x);
+		float epsilon = 1e-5f * lengthSq;
+		return std::fabs(glm::dot(y, y) - lengthSq) <= epsilon && std::fabs(glm::dot(z, z) - lengthSq) <= epsilon &&
+			std::fabs(glm::dot(x, y)) <= epsilon && std::fabs(glm::dot(x, z)) <= epsilon && std::fabs(glm::dot(y, z)) <= epsilon;
+	}
+
+private:
+	std::vector<glm::mat4> models;
+	std::vector<glm::mat3> normals;
+	std::vector<unsigned int> pending;	// objects that need a real inverse
+	UniformBindings<Bindings> programs;
+
+#ifdef OGL_TRANSFORMS_SSE
+	// transpose(inverse(m)) is the cofactor matrix of m divided by det(m).
+	// Each register holds one element of four matrices.
+	void inverseTranspose4(const unsigned int* index)
+	{
+		__m128 m[3][3];
+		for (int c = 0; c < 3; c++)
+			for (int r = 0; r < 3; r++)
+				m[c][r] = _mm_set_ps(models[index[3]][c][r], models[index[2]][c][r],
+					models[index[1]][c][r], models[index[0]][c][r]);
+
+		__m128 cof[3][3];
+		for (int c = 0; c < 3; c++) {
+			int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+			for (int r = 0; r < 3; r++) {
+				int r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+				cof[c][r] = _mm_sub_ps(_mm_mul_ps(m[c1][r1], m[c2][r2]), _mm_mul_ps(m[c1][r2], m[c2][r1]));
+			}
+		}
+		__m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][0], cof[0][0]), _mm_mul_ps(m[0][1], cof[0][1])),
+			_mm_mul_ps(m[0][2], cof[0][2]));
+		__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+		float out[4];
+		for (int c = 0; c < 3; c++)
+			for (int r = 0; r < 3; r++) {
+				_mm_storeu_ps(out, _mm_mul_ps(cof[c][r], invDet));
+				for (int k = 0; k < 4; k++)
+					normals[index[k]][c][r] = out[k];
+			}
+	}
+#endif
+};
+
+#endif // !TRANSFORMS_H
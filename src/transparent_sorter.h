@@ -0,0 +1,100 @@
+#ifndef TRANSPARENT_SORTER_H
+#define TRANSPARENT_SORTER_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "radix_sort.h"
+
+// Back to front order of transparent objects by view space depth. Objects
+// are identified by the order they were added in; when a frame adds the
+// same objects in the same order as the last one, the last order is the
+// starting point and an insertion sort fixes what moved, which costs about
+// one pass for a slowly moving camera. Otherwise, or when too much moved,
+// the keys are radix sorted. Equal depths keep the add order, so nothing
+// is dropped and the result does not flicker. The buffers are kept from
+// frame to frame.
+class TransparentSorter
+{
+public:
+	TransparentSorter() : previousCount(0), eye(0.0f), forward(0.0f, 0.0f, -1.0f) {}
+
+	// Start a frame seen from eye looking along forward
+	void begin(const glm::vec3& eye, const glm::vec3& forward)
+	{
+		this->eye = eye;
+		this->forward = forward;
+		depths.clear();
+	}
+	// Returns the index reported by operator[]
+	unsigned int add(const glm::vec3& position)
+	{
+		depths.push_back(glm::dot(position - eye, forward));
+		return depths.size() - 1;
+	}
+
+	void sort()
+	{
+		unsigned int count = depths.size();
+		keys.resize(count);
+		bool coherent = count == previousCount && order.size() == count;
+		if (coherent) {
+			for (unsigned int i = 0; i < count; i++)
+				keys[i] = keyOf(order[i]);
+			coherent = insertionSort(4 * count + 16);
+		}
+		if (!coherent) {
+			for (unsigned int i = 0; i < count; i++)
+				keys[i] = keyOf(i);
+			radixSort64(keys, scratch);
+		}
+		order.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+			order[i] = (uint32_t)keys[i];
+		previousCount = count;
+	}
+
+	// Objects far to near, valid after sort()
+	unsigned int size() const { return order.size(); }
+	unsigned int operator[](unsigned int i) const { return order[i]; }
+
+private:
+	std::vector<float> depths;
+	std::vector<uint64_t> keys;		// inverted depth bits, then the index
+	std::vector<uint64_t> scratch;
+	std::vector<uint32_t> order;
+	unsigned int previousCount;
+	glm::vec3 eye, forward;
+
+	// Ascending keys give descending depth, ties ascending index
+	uint64_t keyOf(uint32_t index) const
+	{
+		uint32_t bits;
+		std::memcpy(&bits, &depths[index], sizeof(bits));
+		// float bits to an unsigned order, negative depths included
+		bits ^= (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+		return (uint64_t)~bits << 32 | index;
+	}
+
+	// Gives up after maxMoves element moves, the keys are then unsorted
+	bool insertionSort(unsigned int maxMoves)
+	{
+		unsigned int moves = 0;
+		for (unsigned int i = 1; i < keys.size(); i++) {
+			uint64_t key = keys[i];
+			unsigned int j = i;
+			for (; j > 0 && keys[j - 1] > key; j--) {
+				keys[j] = keys[j - 1];
+				if (++moves > maxMoves)
+					return false;
+			}
+			keys[j] = key;
+		}
+		return true;
+	}
+};
+
+#endif // !TRANSPARENT_SORTER_H
@@ -0,0 +1,35 @@
+#ifndef UBO_H
+#define UBO_H
+
+class UBO
+{
+public:
+	unsigned int id;
+	GLsizeiptr size;
+	UBO(GLsizeiptr size, const void* data = NULL, GLenum usage = GL_DYNAMIC_DRAW) : size(size) {
+		glGenBuffers(1, &id);
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		glBufferData(GL_UNIFORM_BUFFER, size, data, usage);
+	}
+	inline void bind() const { glBindBuffer(GL_UNIFORM_BUFFER, id); }
+	inline void unbind() const { glBindBuffer(GL_UNIFORM_BUFFER, 0); }
+	void update(GLintptr offset, GLsizeiptr bytes, const void* data) const {
+		glBindBuffer(GL_UNIFORM_BUFFER, id);
+		glBufferSubData(GL_UNIFORM_BUFFER, offset, bytes, data);
+	}
+	// Attach the whole buffer or a range of it to a uniform block binding
+	void bindBase(unsigned int binding) const { glBindBufferBase(GL_UNIFORM_BUFFER, binding, id); }
+	void bindRange(unsigned int binding, GLintptr offset, GLsizeiptr bytes) const {
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, id, offset, bytes);
+	}
+	void Delete() { glDeleteBuffers(1, &id); }
+
+	// Offsets passed to bindRange have to be a multiple of this
+	static GLint offsetAlignment() {
+		GLint alignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		return alignment;
+	}
+};
+
+#endif // !UBO_H
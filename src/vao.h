@@ -7,10 +7,12 @@ public:
     VAO() {
         glGenVertexArrays(1, &id);
     }
-    void bind() const { glBindVertexArray(id); }
-    void unbind() const { glBindVertexArray(0); }
+    void bind() const { GLState::bindVertexArray(id); }
+    void unbind() const { GLState::bindVertexArray(0); }
     void linkVBO(VBO vbo) const { vbo.bind();}
     void linkEBO(EBO ebo) const { ebo.bind(); }
+    // Per instance attributes for instanced draws, the VAO has to be bound
+    void linkInstances(const InstanceBuffer& instances) const { instances.attach(); }
     void setAttributes(bool normals = true) {
         unsigned int stride = 5;
         unsigned int vertexCoordStart = 3;
@@ -29,7 +31,7 @@ public:
         glVertexAttribPointer(vertexCoordAttr, 2, GL_FLOAT, GL_FALSE, stride * sizeof(float), (void*)(vertexCoordStart * sizeof(float)));
         glEnableVertexAttribArray(vertexCoordAttr);
     }
-    void Delete() { glDeleteVertexArrays(1, &id); }
+    void Delete() { GLState::deleteVertexArray(id); }
 };
 
 #endif // !VAO_H
@@ -0,0 +1,41 @@
+// Checks TransformBatch::update() against glm, no GL context needed. Seven
+// unevenly scaled objects fill one group of four and a padded last group.
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <iostream>
+
+#include "transforms.h"
+
+int main()
+{
+	TransformBatch batch;
+	for (int i = 0; i < 7; i++) {
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(i, -0.5f * i, 2.0f));
+		model = glm::rotate(model, glm::radians(25.0f * i + 10.0f), glm::normalize(glm::vec3(1.0f, 2.0f, 0.5f * i)));
+		model = glm::scale(model, glm::vec3(0.5f + i, 2.0f, 0.25f + 0.1f * i));
+		if (TransformBatch::hasUniformScale(model)) {
+			std::cout << "ERROR::TRANSFORMS_TEST::UNIFORM_SCALE " << i << std::endl;
+			return 1;
+		}
+		batch.add(model);
+	}
+	// rotation only, kept as mat3(model)
+	batch.add(glm::rotate(glm::mat4(1.0f), glm::radians(30.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+	batch.update();
+
+	int failures = 0;
+	for (unsigned int i = 0; i < batch.size(); i++) {
+		glm::mat3 expected = glm::transpose(glm::inverse(glm::mat3(batch.model(i))));
+		for (int c = 0; c < 3; c++)
+			for (int r = 0; r < 3; r++)
+				if (std::fabs(batch.normal(i)[c][r] - expected[c][r]) > 1e-4f * (1.0f + std::fabs(expected[c][r]))) {
+					std::cout << "ERROR::TRANSFORMS_TEST::NORMAL_MATRIX object " << i << " [" << c << "][" << r << "] "
+						<< batch.normal(i)[c][r] << " instead of " << expected[c][r] << std::endl;
+					failures++;
+				}
+	}
+	std::cout << batch.size() << " normal matrices checked, " << failures << " wrong" << std::endl;
+	return failures == 0 ? 0 : 1;
+}